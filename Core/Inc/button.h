@@ -13,12 +13,57 @@
 #define BUTTON_H
 
 #include "stm32f3xx_hal.h"
+#include "button_queue.h"
+#include "button_time.h"
+#include "button_timer.h"
 
 
 #define DEBOUNCE_DURATION			(uint16_t)200
 #define LONG_PRESS_DURATION 		(uint16_t)1000
 #define DOUBLE_PRESS_WINDOW 		(uint16_t)500
 
+/* Same durations in timebase ticks (button_time.h) */
+#define BUTTON_LONG_PRESS_TICKS		BUTTON_MS_TO_TICKS(LONG_PRESS_DURATION)
+#define BUTTON_DOUBLE_PRESS_TICKS	BUTTON_MS_TO_TICKS(DOUBLE_PRESS_WINDOW)
+
+/* Event bits returned by Button_Poll and Button_PollAll */
+#define BUTTON_MASK_PRESS			(1U << BUTTON_EVENT_PRESS)
+#define BUTTON_MASK_RELEASE			(1U << BUTTON_EVENT_RELEASE)
+#define BUTTON_MASK_LONG			(1U << BUTTON_EVENT_LONG)
+#define BUTTON_MASK_DOUBLE			(1U << BUTTON_EVENT_DOUBLE)
+#define BUTTON_MASK_REPEAT			(1U << BUTTON_EVENT_REPEAT)
+#define BUTTON_MASK_CLICK			(1U << BUTTON_EVENT_CLICK)
+#define BUTTON_MASK_ALL				(BUTTON_MASK_PRESS | BUTTON_MASK_RELEASE | BUTTON_MASK_LONG | \
+									 BUTTON_MASK_DOUBLE | BUTTON_MASK_REPEAT | BUTTON_MASK_CLICK)
+
+
+/**
+ * @enum ButtonSource
+ *
+ * @brief Where the state of a button comes from.
+ */
+typedef enum {
+    BUTTON_SOURCE_PIN = 0,			/**< Own GPIO pin, sampled and debounced by the button. */
+    BUTTON_SOURCE_PORT,				/**< Debounced state pushed by a ButtonPort (button_port.h). */
+    BUTTON_SOURCE_EXTI,				/**< Own pin, debounced by masking its EXTI line (button_exti.h). */
+    BUTTON_SOURCE_CAPTURE,			/**< Own pin, edges timestamped by timer input capture (button_capture.h). */
+    BUTTON_SOURCE_DEFER,			/**< Own pin, edges recorded by EXTI and processed in PendSV (button_defer.h). */
+    BUTTON_SOURCE_TOUCH,			/**< Capacitive key acquired by the touch sensing controller (button_touch.h). */
+} ButtonSource;
+
+struct ButtonSubscription;
+
+/**
+ * @struct ButtonRepeat
+ *
+ * @brief Auto-repeat curve, shared by any number of buttons.
+ */
+typedef struct {
+    uint16_t delay; 				/**< Hold time before the first REPEAT, in milliseconds. */
+    uint16_t interval; 				/**< Time between the first two REPEAT events, in milliseconds. */
+    uint16_t min_interval; 			/**< Shortest time between two REPEAT events, in milliseconds. */
+    uint16_t accel; 				/**< Interval multiplier after each REPEAT, in 1/256 (256 = constant rate, less = faster). */
+} ButtonRepeat;
 
 /**
  * @struct Button
@@ -28,12 +73,25 @@
 typedef struct {
     GPIO_TypeDef* GPIO_Port; 		/**< GPIO port of the button. */
     uint16_t _pin; 					/**< Pin number of the button. */
-    uint16_t _delay; 				/**< Debounce delay for the button. */
+    uint16_t _delay; 				/**< Debounce delay for the button, in milliseconds. */
     GPIO_PinState _state; 			/**< Current state of the button. */
-    uint8_t _has_changed; 			/**< Flag indicating if the button state has changed. */
-    uint32_t _press_start_time; 	/**< Timestamp when the button press started. */
-    uint8_t _long_press_event; 		/**< Flag indicating a long press event. */
-    uint8_t _double_press_event; 	/**< Flag indicating a double press event. */
+    uint8_t _source; 				/**< One of ButtonSource. */
+    volatile uint8_t _events; 		/**< Latched BUTTON_MASK_* events not yet consumed. */
+    ButtonTime _ignore_until; 		/**< End of the debounce period of this button. */
+    ButtonTime _press_start_time; 	/**< Timestamp when the button press started. */
+    ButtonTime _last_press_time; 	/**< Start of the previous short press, for double press detection. */
+    ButtonTimer _timer; 			/**< Deadline of the pending timed event (button_timer.h). */
+    volatile uint8_t _long_sent; 	/**< LONG already reported for the current press. */
+    uint16_t _click_gap; 			/**< Longest release between two clicks of a sequence, in milliseconds. */
+    uint8_t _click_immediate; 		/**< 1 to report the first click at once instead of at the end of the sequence. */
+    volatile uint8_t _clicks; 		/**< Clicks of the sequence in progress, at most INT8_MAX. */
+    volatile uint8_t _click_count; 	/**< Clicks of the last reported sequence. */
+    const ButtonRepeat* _repeat; 	/**< Auto-repeat curve, NULL if disabled. */
+    uint32_t _repeat_next; 			/**< Hold time of the next REPEAT, in milliseconds. */
+    uint16_t _repeat_interval; 		/**< Current time between REPEAT events, in milliseconds. */
+    volatile uint8_t _repeats; 		/**< REPEAT events of the current press. */
+    ButtonQueue* _queue; 			/**< Queue receiving the button events, NULL if unused. */
+    struct ButtonSubscription* _subscriptions; /**< Event callbacks (button_callback.h), NULL if none. */
 } Button;
 
 /**
@@ -46,12 +104,65 @@ typedef struct {
  */
 void Button_Init(Button* button, GPIO_TypeDef* GPIO_Port, uint16_t pin);
 
+/**
+ * @brief Sends the events of a button to a queue, in addition to the event flags.
+ *
+ * @param button Pointer to the Button structure.
+ * @param queue Queue receiving the events, or NULL to stop queuing.
+ */
+void Button_Set_Queue(Button* button, ButtonQueue* queue);
+
+/**
+ * @brief Configures the click recognizer of a button.
+ *
+ * @param button Pointer to the Button structure.
+ * @param gap_ms Longest release between two clicks of a sequence, in milliseconds.
+ * @param immediate 1 to report CLICK(1) at the first release, 0 to wait for the end of the sequence.
+ */
+void Button_Set_Click(Button* button, uint16_t gap_ms, uint8_t immediate);
+
+/**
+ * @brief Enables auto-repeat while the button is held.
+ *
+ * @param button Pointer to the Button structure.
+ * @param repeat Repeat curve (kept by reference), or NULL to disable.
+ */
+void Button_Set_Repeat(Button* button, const ButtonRepeat* repeat);
+
+/**
+ * @brief Advances the state machine of a button with a new sample of its pin.
+ *
+ * @param button Pointer to the Button structure.
+ * @param current_state Sampled (or already debounced) pin level.
+ * @param now Current time (Button_Time_Now).
+ * @return Mask of the BUTTON_MASK_* events detected by this sample.
+ */
+BUTTON_CCM_CODE uint8_t Button_Update(Button* button, GPIO_PinState current_state, ButtonTime now);
+
 /**
  * @brief Handles button interrupts, debounces the button, and updates its state.
  *
  * @param button Pointer to the Button structure.
  */
-void Button_IRQ_Handler(Button* button);
+BUTTON_CCM_CODE void Button_IRQ_Handler(Button* button);
+
+/**
+ * @brief Samples one button and returns all its pending events.
+ *
+ * @param button Pointer to the Button structure.
+ * @return Mask of BUTTON_MASK_* events, 0 if nothing happened.
+ */
+uint8_t Button_Poll(Button* button);
+
+/**
+ * @brief Samples an array of buttons, reading each GPIO port only once.
+ *
+ * @param buttons Array of Button structures.
+ * @param count Number of buttons in the array.
+ * @param events_out Receives the BUTTON_MASK_* events of each button.
+ * @return OR of all the returned event masks, 0 if nothing happened.
+ */
+uint8_t Button_PollAll(Button* buttons, uint32_t count, uint8_t* events_out);
 
 /**
  * @brief Checks if the button is currently pressed.
@@ -77,4 +188,12 @@ uint8_t Button_Long_Pressed(Button* button);
  */
 uint8_t Button_Double_Pressed(Button* button);
 
+/**
+ * @brief Returns the number of clicks of the last reported click sequence.
+ *
+ * @param button Pointer to the Button structure.
+ * @return Value of the last CLICK event, 0 if none yet.
+ */
+uint8_t Button_Clicks(Button* button);
+
 #endif /* BUTTON_H */
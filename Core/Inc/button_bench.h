@@ -0,0 +1,69 @@
+/**
+ * @file button_bench.h
+ *
+ * @brief Cycle-count benchmarks of the button library.
+ *
+ * @details Uses the DWT cycle counter of the Cortex-M4. Only built when
+ * BUTTON_BENCHMARK is defined; read the results with the debugger.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_BENCH_H
+#define BUTTON_BENCH_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+#include "button_defer.h"
+
+
+/**
+ * @struct ButtonBenchEdge
+ *
+ * @brief Average CPU cycles of the deferred top half of one EXTI edge, per implementation.
+ */
+typedef struct {
+    uint32_t hal; 					/**< HAL_GPIO_EXTI_IRQHandler and a callback calling Button_Defer_Edge (the default vectors). */
+    uint32_t ll; 					/**< LL_EXTI flag accessors and Button_Defer_Edge. */
+    uint32_t reg; 					/**< Button_Defer_IRQHandler (the BUTTON_FAST_ISR vectors). */
+} ButtonBenchEdge;
+
+/**
+ * @brief Starts the DWT cycle counter.
+ */
+static inline void Button_Bench_Init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief Returns the current CPU cycle count.
+ *
+ * @return DWT cycle counter.
+ */
+static inline uint32_t Button_Bench_Cycles(void) {
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Measures the port debounce engine selected by BUTTON_PORT_ENGINE.
+ *
+ * Debounces two ports (32 pins) of pseudo-random chatter.
+ *
+ * @param iterations Number of ticks to average over.
+ * @return Average CPU cycles per tick for the 32 pins.
+ */
+uint32_t Button_Bench_Port_Debounce(uint32_t iterations);
+
+/**
+ * @brief Measures the top half of an EXTI edge through the HAL, LL and register paths.
+ *
+ * @param defer Deferred handler the button is attached to.
+ * @param button Button on an EXTI line, pin at rest.
+ * @param iterations Number of edges to average over.
+ * @param result Average CPU cycles per edge of each path.
+ */
+void Button_Bench_Edge(ButtonDefer* defer, Button* button, uint32_t iterations, ButtonBenchEdge* result);
+
+#endif /* BUTTON_BENCH_H */
@@ -0,0 +1,110 @@
+/**
+ * @file button_callback.h
+ *
+ * @brief Event callbacks of buttons, run in a chosen execution context.
+ *
+ * @details A subscription is a small user-allocated object holding one
+ * callback, its user pointer, the mask of events it wants (on press,
+ * release, click, long, double, repeat) and the context it runs in:
+ * - BUTTON_CONTEXT_ISR: called at once, where the event is detected (EXTI,
+ *   timer or PendSV handler). Keep these short.
+ * - BUTTON_CONTEXT_DEFERRED: called from PendSV_Handler, at the lowest
+ *   interrupt priority.
+ * - BUTTON_CONTEXT_MAIN: called from Button_Callback_Dispatch in the main
+ *   loop.
+ * Subscriptions are chained on their button, so a button costs one pointer
+ * whatever the number of event kinds. Deferred and main-loop events go
+ * through one ButtonQueue per context; no heap is used.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_CALLBACK_H
+#define BUTTON_CALLBACK_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+/**
+ * @enum ButtonContext
+ *
+ * @brief Where a callback runs.
+ */
+typedef enum {
+    BUTTON_CONTEXT_ISR = 0,			/**< Where the event is detected. */
+    BUTTON_CONTEXT_DEFERRED,		/**< PendSV_Handler. */
+    BUTTON_CONTEXT_MAIN,			/**< Button_Callback_Dispatch(BUTTON_CONTEXT_MAIN). */
+} ButtonContext;
+
+/**
+ * @brief Button event callback.
+ *
+ * @param event Event, its source is the Button.
+ * @param user User pointer given at subscription.
+ */
+typedef void (*ButtonCallback)(const ButtonEvent* event, void* user);
+
+/**
+ * @struct ButtonSubscription
+ *
+ * @brief One callback of a button.
+ */
+typedef struct ButtonSubscription {
+    ButtonCallback callback; 		/**< Function called for the events. */
+    void* user; 					/**< User pointer passed to the callback. */
+    uint8_t _mask; 					/**< BUTTON_MASK_* events delivered. */
+    uint8_t _context; 				/**< One of ButtonContext. */
+    struct ButtonSubscription* _next; /**< Next subscription of the same button. */
+} ButtonSubscription;
+
+/**
+ * @brief Initializes the deferred and main-loop event queues and sets PendSV to the lowest priority.
+ */
+void Button_Callback_Init(void);
+
+/**
+ * @brief Registers a callback for some events of a button.
+ *
+ * @param button Pointer to the Button structure.
+ * @param subscription Subscription storage, owned by the caller until unsubscribed.
+ * @param mask BUTTON_MASK_* events to deliver.
+ * @param context Context the callback runs in.
+ * @param callback Function called for each event.
+ * @param user User pointer passed to the callback.
+ */
+void Button_Subscribe(Button* button, ButtonSubscription* subscription, uint8_t mask, ButtonContext context,
+                      ButtonCallback callback, void* user);
+
+/**
+ * @brief Removes a callback of a button.
+ *
+ * @param button Pointer to the Button structure.
+ * @param subscription Subscription given to Button_Subscribe.
+ */
+void Button_Unsubscribe(Button* button, ButtonSubscription* subscription);
+
+/**
+ * @brief Delivers an event of a button to its subscriptions. Called by the button library.
+ *
+ * @param button Pointer to the Button structure.
+ * @param event Detected event.
+ */
+BUTTON_CCM_CODE void Button_Callback_Notify(Button* button, const ButtonEvent* event);
+
+/**
+ * @brief Runs the callbacks queued for a context.
+ *
+ * @param context BUTTON_CONTEXT_DEFERRED from PendSV_Handler, BUTTON_CONTEXT_MAIN from the main loop.
+ */
+void Button_Callback_Dispatch(ButtonContext context);
+
+/**
+ * @brief Returns the number of events dropped because a context queue was full.
+ *
+ * @param context BUTTON_CONTEXT_DEFERRED or BUTTON_CONTEXT_MAIN.
+ * @return Overflow count since initialization.
+ */
+uint32_t Button_Callback_Overflows(ButtonContext context);
+
+#endif /* BUTTON_CALLBACK_H */
@@ -0,0 +1,85 @@
+/**
+ * @file button_capture.h
+ *
+ * @brief Timer input capture button inputs.
+ *
+ * @details For buttons on timer-capable pins (SWA, SWB and SWC on PA0-PA2 are
+ * TIM2 channels 1-3). The channel captures both edges through the hardware
+ * digital filter (ICxF), and DMA stores each captured timestamp in a circular
+ * buffer, so contact bounce costs no CPU time at all. Button_Capture_Process
+ * walks the new edges and commits a level once it stayed stable for the
+ * debounce delay of the button. The button is updated with the time of the
+ * captured edge, so event timestamps, the long press deadline and the double
+ * press window all have timer resolution, as do press durations.
+ *
+ * The timer is a free-running 32-bit counter (TIM2) at BUTTON_CAPTURE_TIMER_HZ,
+ * initialized by the application with its channel DMA linked (__HAL_LINKDMA)
+ * to a circular, word-sized, peripheral to memory DMA channel.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_CAPTURE_H
+#define BUTTON_CAPTURE_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+#define BUTTON_CAPTURE_EDGES		32		/* Size of the edge timestamp buffer */
+
+#ifndef BUTTON_CAPTURE_TIMER_HZ
+#define BUTTON_CAPTURE_TIMER_HZ		1000000	/* Counting frequency of the capture timer */
+#endif
+
+
+/**
+ * @struct ButtonCapture
+ *
+ * @brief Input capture channel feeding one button.
+ */
+typedef struct {
+    TIM_HandleTypeDef* htim; 		/**< Free-running 32-bit capture timer. */
+    uint32_t channel; 				/**< Capture channel (TIM_CHANNEL_x). */
+    Button* button; 				/**< Button fed by the channel. */
+    uint32_t _guard; 				/**< Debounce delay in timer counts. */
+    uint32_t _read; 				/**< Next buffer index to process. */
+    uint32_t _last_edge; 			/**< Timestamp of the last processed edge. */
+    uint32_t _press_edge; 			/**< Timestamp of the edge that started the current press. */
+    uint32_t _duration; 			/**< Length of the last complete press, in timer counts. */
+    GPIO_PinState _raw; 			/**< Pin level after the last processed edge. */
+    uint32_t _buffer[BUTTON_CAPTURE_EDGES]; /**< Edge timestamps written by DMA. */
+} ButtonCapture;
+
+/**
+ * @brief Configures a capture channel and starts recording the edges of a button.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @param htim Initialized timer, with the channel DMA linked.
+ * @param channel Capture channel of the button pin (TIM_CHANNEL_x).
+ * @param filter Input filter (ICxF), 0 to 15.
+ * @param button Button on the capture pin.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Capture_Start(ButtonCapture* capture, TIM_HandleTypeDef* htim, uint32_t channel,
+                                       uint8_t filter, Button* button);
+
+/**
+ * @brief Debounces the edges captured since the last call and updates the button.
+ *
+ * Call regularly, e.g. from the main loop. The buffer must not wrap between two calls.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @return Mask of the BUTTON_MASK_* events produced.
+ */
+uint8_t Button_Capture_Process(ButtonCapture* capture);
+
+/**
+ * @brief Returns the length of the last complete press.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @return Press duration in timer counts (microseconds at 1 MHz).
+ */
+uint32_t Button_Capture_Duration(ButtonCapture* capture);
+
+#endif /* BUTTON_CAPTURE_H */
@@ -0,0 +1,30 @@
+/**
+ * @file button_ccm.h
+ *
+ * @brief Placement of the button interrupt path in CCMRAM.
+ *
+ * @details With BUTTON_CCMRAM defined, the functions on the EXTI edge path
+ * and the state they touch go to the .ccmram section of the linker script,
+ * copied from flash by the startup code. The 8 KB CCMRAM of the STM32F303 is
+ * on the instruction bus with no wait states, unlike flash at 72 MHz
+ * (FLASH_LATENCY_2), so the ISR timing no longer depends on the flash
+ * prefetch. The functions are long calls, as CCMRAM is out of BL range of
+ * flash. DMA cannot reach CCMRAM: DMA buffers (ButtonScan, ButtonCapture)
+ * must stay in RAM.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_CCM_H
+#define BUTTON_CCM_H
+
+
+#ifdef BUTTON_CCMRAM
+#define BUTTON_CCM_CODE				__attribute__((section(".ccmram.text"), long_call))
+#define BUTTON_CCM_DATA				__attribute__((section(".ccmram.data")))
+#else
+#define BUTTON_CCM_CODE
+#define BUTTON_CCM_DATA
+#endif
+
+#endif /* BUTTON_CCM_H */
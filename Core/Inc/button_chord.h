@@ -0,0 +1,76 @@
+/**
+ * @file button_chord.h
+ *
+ * @brief Detection of button combinations (chords) from a pressed bitmask.
+ *
+ * @details Chords are pin masks in a user table, e.g. SWA | SWB. The
+ * detector consumes the debounced pressed state of up to 32 inputs (for
+ * example Button_Port_State) and reports a CHORD event when all the pins of
+ * a chord went down within the skew window. The presses that formed a chord,
+ * and their releases, are suppressed; presses that end up in no chord are
+ * reported as individual PRESS/RELEASE events, after the window. Pins that
+ * belong to no chord pass through at once. Each call costs one bitmask
+ * compare per chord.
+ *
+ * Events go to an optional queue with the detector as source; the value of
+ * PRESS and RELEASE events is the pin index.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_CHORD_H
+#define BUTTON_CHORD_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+/**
+ * @struct ButtonChord
+ *
+ * @brief Chord detector over one pressed bitmask.
+ */
+typedef struct {
+    const uint32_t* chords; 		/**< Pin mask of each chord. */
+    uint32_t count; 				/**< Number of chords. */
+    ButtonQueue* queue; 			/**< Queue receiving the events, NULL if unused. */
+    uint16_t skew; 					/**< Longest time between the first and last press of a chord, in milliseconds. */
+    uint32_t _pins; 				/**< Pins used by any chord. */
+    uint32_t _state; 				/**< Last pressed state. */
+    uint32_t _pending; 				/**< Pressed pins not yet resolved. */
+    uint32_t _consumed; 			/**< Held pins of a recognized chord, releases suppressed. */
+    uint32_t _pressed; 				/**< Individual presses reported by the last call. */
+    ButtonTime _start; 				/**< Time of the first pending press. */
+} ButtonChord;
+
+/**
+ * @brief Initializes a chord detector.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @param chords Pin mask of each chord, kept by reference.
+ * @param count Number of chords.
+ * @param skew_ms Longest time between the first and last press of a chord, in milliseconds.
+ * @param queue Queue receiving the events, or NULL.
+ */
+void Button_Chord_Init(ButtonChord* chord, const uint32_t* chords, uint32_t count, uint16_t skew_ms,
+                       ButtonQueue* queue);
+
+/**
+ * @brief Feeds the current pressed state to the detector.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @param state Debounced pressed pins.
+ * @param now Current time (Button_Time_Now).
+ * @return Index of the chord recognized by this call, -1 if none.
+ */
+int32_t Button_Chord_Process(ButtonChord* chord, uint32_t state, ButtonTime now);
+
+/**
+ * @brief Returns the individual presses reported by the last Button_Chord_Process.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @return Mask of the pins.
+ */
+uint32_t Button_Chord_Pressed(ButtonChord* chord);
+
+#endif /* BUTTON_CHORD_H */
@@ -0,0 +1,103 @@
+/**
+ * @file button_defer.h
+ *
+ * @brief Two-stage EXTI button handling: record in the EXTI ISR, process in PendSV.
+ *
+ * @details The top half, called from the EXTI interrupts, only acknowledges
+ * the lines, takes one timestamp, records (line, timestamp, level) for each
+ * pending line and pends PendSV. The bottom half, Button_Defer_Process, runs
+ * from PendSV_Handler at the lowest priority and feeds the records to the
+ * button state machines, so the EXTI interrupts can run at high priority
+ * with a short, fixed cost. Edges arriving while PendSV is pending are
+ * processed in the same pass.
+ *
+ * If the record ring overflows, the lines that lost a record are sampled
+ * again by the next pass, so the buttons end up in the right state. Lines
+ * with edges are also sampled again when their debounce delay ends, which
+ * needs Button_Timer_Tick (button_timer.h).
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_DEFER_H
+#define BUTTON_DEFER_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+#include "button_exti.h"
+
+
+#ifndef BUTTON_DEFER_SIZE
+#define BUTTON_DEFER_SIZE			16		/* Must be a power of two */
+#endif
+
+#if (BUTTON_DEFER_SIZE & (BUTTON_DEFER_SIZE - 1)) != 0
+#error "BUTTON_DEFER_SIZE must be a power of two"
+#endif
+
+
+/**
+ * @struct ButtonDeferRecord
+ *
+ * @brief One edge seen by the top half.
+ */
+typedef struct {
+    uint32_t timestamp; 			/**< Low 32 bits of Button_Time_Now() at the edge, extended when processed. */
+    uint8_t line; 					/**< EXTI line. */
+    uint8_t level; 					/**< Pin level read in the ISR (GPIO_PinState). */
+} ButtonDeferRecord;
+
+/**
+ * @struct ButtonDefer
+ *
+ * @brief Buttons of the EXTI lines and the records waiting for the bottom half.
+ */
+typedef struct {
+    volatile uint32_t _head; 		/**< Next record written by the top half. */
+    volatile uint32_t _tail; 		/**< Next record read by the bottom half. */
+    volatile uint16_t _lost; 		/**< Lines that lost a record, sampled again by the bottom half. */
+    uint16_t _verify; 				/**< Lines to sample again at the end of their debounce delay. */
+    ButtonTimer _timer; 			/**< Runs the bottom half when the next debounce delay ends. */
+    ButtonDeferRecord _records[BUTTON_DEFER_SIZE]; /**< Record ring. */
+    Button* _buttons[BUTTON_EXTI_LINES]; /**< Button on each line, NULL if none. */
+} ButtonDefer;
+
+/**
+ * @brief Initializes a deferred handler and sets PendSV to the lowest priority.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ */
+void Button_Defer_Init(ButtonDefer* defer);
+
+/**
+ * @brief Hands the edges of a button to the deferred handler.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param button Button whose pin is configured as EXTI input.
+ */
+void Button_Defer_Attach(ButtonDefer* defer, Button* button);
+
+/**
+ * @brief Top half for one line. Call from HAL_GPIO_EXTI_Callback.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param GPIO_Pin Pin of the interrupting line.
+ */
+BUTTON_CCM_CODE void Button_Defer_Edge(ButtonDefer* defer, uint16_t GPIO_Pin);
+
+/**
+ * @brief Top half for all pending lines of an EXTI vector. Call from the EXTIx_IRQHandler.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param lines Lines of the vector (BUTTON_EXTI_LINE(n), BUTTON_EXTI_LINES_9_5...).
+ */
+BUTTON_CCM_CODE void Button_Defer_IRQHandler(ButtonDefer* defer, uint32_t lines);
+
+/**
+ * @brief Bottom half. Call from PendSV_Handler.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ */
+void Button_Defer_Process(ButtonDefer* defer);
+
+#endif /* BUTTON_DEFER_H */
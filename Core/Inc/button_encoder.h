@@ -0,0 +1,103 @@
+/**
+ * @file button_encoder.h
+ *
+ * @brief Quadrature rotary encoders on a timer in encoder mode.
+ *
+ * @details The timer counts the quadrature edges in hardware, so turning
+ * the knob costs no interrupt at all. Button_Encoder_Process samples the
+ * counter, converts the counts to detents and posts a ROTATE event with the
+ * signed number of detents to the same queue as the buttons, with the
+ * encoder as source. The speed of rotation is tracked in detents per
+ * second; above the acceleration threshold, each detent counts for more.
+ * The push switch of the encoder, if any, is an ordinary Button.
+ *
+ * The timer (encoder mode, input filter, period 0xFFFF) is configured by
+ * the application.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_ENCODER_H
+#define BUTTON_ENCODER_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+#define BUTTON_ENCODER_TICK_MS		10		/* Suggested sampling period in milliseconds */
+
+
+/**
+ * @struct ButtonEncoder
+ *
+ * @brief Encoder counted by a timer.
+ */
+typedef struct {
+    TIM_HandleTypeDef* htim; 		/**< Timer in encoder mode. */
+    ButtonQueue* queue; 			/**< Queue receiving the ROTATE events, NULL if unused. */
+    uint8_t steps; 					/**< Counts per detent (4 in TI12 mode for most encoders). */
+    uint16_t threshold; 			/**< Speed in detents/s above which rotation accelerates, 0 = never. */
+    uint16_t gain; 					/**< Extra detents per detent, /256, per detent/s above the threshold. */
+    uint16_t _last; 				/**< Counter at the last sample. */
+    int32_t _residue; 				/**< Counts not yet making a detent. */
+    int32_t _position; 				/**< Sum of the reported detents. */
+    uint32_t _velocity; 			/**< Speed in detents/s, from the time between detents. */
+    ButtonTime _time; 				/**< Time of the last sample that completed detents. */
+} ButtonEncoder;
+
+/**
+ * @brief Starts counting.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @param htim Timer initialized in encoder mode.
+ * @param steps Counts per detent.
+ * @param queue Queue receiving the ROTATE events, or NULL.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Encoder_Start(ButtonEncoder* encoder, TIM_HandleTypeDef* htim, uint8_t steps,
+                                       ButtonQueue* queue);
+
+/**
+ * @brief Stops counting.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Encoder_Stop(ButtonEncoder* encoder);
+
+/**
+ * @brief Sets the acceleration of an encoder.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @param threshold Speed in detents/s above which rotation accelerates, 0 to disable.
+ * @param gain Extra detents per detent, /256, per detent/s above the threshold.
+ */
+void Button_Encoder_Set_Accel(ButtonEncoder* encoder, uint16_t threshold, uint16_t gain);
+
+/**
+ * @brief Samples the counter and reports the rotation.
+ *
+ * Call every BUTTON_ENCODER_TICK_MS, from the main loop or a timer interrupt.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return Detents turned since the last call after acceleration, positive when counting up.
+ */
+int32_t Button_Encoder_Process(ButtonEncoder* encoder);
+
+/**
+ * @brief Returns the sum of the reported detents.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return Position in accelerated detents.
+ */
+int32_t Button_Encoder_Position(ButtonEncoder* encoder);
+
+/**
+ * @brief Returns the speed of rotation.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return Speed in detents/s, 0 when the knob does not turn.
+ */
+uint32_t Button_Encoder_Velocity(ButtonEncoder* encoder);
+
+#endif /* BUTTON_ENCODER_H */
@@ -0,0 +1,155 @@
+/**
+ * @file button_expander.h
+ *
+ * @brief Buttons on I2C GPIO expanders (MCP23017, MCP23008, PCF8574...).
+ *
+ * @details The INT line of an expander is wired to an EXTI input. Its edge
+ * only queues a read: the bus then reads the input registers of the pending
+ * expanders one after the other with HAL_I2C_Mem_Read_DMA (or
+ * HAL_I2C_Master_Receive_DMA for register-less parts), each completion
+ * starting the next transfer. Every read goes through a port debouncer
+ * (button_port.h), so attached buttons get the usual events, and expanders
+ * still bouncing are read again from Button_Expander_Tick until they settle.
+ * The bus is idle the rest of the time.
+ *
+ * Several expanders may share one bus and one (wired-OR) INT line; with 16
+ * inputs each, 4 MCP23017 give 64 buttons. The application forwards the
+ * HAL callbacks:
+ * - HAL_GPIO_EXTI_Callback: Button_Expander_Edge
+ * - HAL_I2C_MemRxCpltCallback, HAL_I2C_MasterRxCpltCallback: Button_Expander_Complete
+ * - HAL_I2C_ErrorCallback: Button_Expander_Error
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_EXPANDER_H
+#define BUTTON_EXPANDER_H
+
+#include "stm32f3xx_hal.h"
+#include "button_port.h"
+
+
+#define BUTTON_EXPANDER_NO_REG		0xFFFF	/* Register-less expander (PCF857x) */
+
+#define BUTTON_EXPANDER_MCP23017_GPIO	0x12	/* GPIOA then GPIOB, IOCON.BANK = 0 */
+#define BUTTON_EXPANDER_MCP23008_GPIO	0x09	/* GPIO */
+
+
+/**
+ * @struct ButtonExpander
+ *
+ * @brief One expander and the debounce state of its inputs.
+ */
+typedef struct ButtonExpander {
+    uint16_t address; 				/**< I2C address, shifted left as for HAL (0x40 for MCP23017 A2..A0 = 0). */
+    uint16_t reg; 					/**< Input register, BUTTON_EXPANDER_NO_REG if none. */
+    uint8_t size; 					/**< Bytes read, 1 or 2. */
+    GPIO_TypeDef* int_port; 		/**< GPIO port of the INT line. */
+    uint16_t int_pin; 				/**< EXTI pin of the INT line (active low). */
+    volatile uint8_t _pending; 		/**< A read is queued. */
+    volatile uint8_t _unsettled; 	/**< Needs another read at the next tick. */
+    uint8_t _data[2]; 				/**< DMA buffer. */
+    ButtonPort _port; 				/**< Debouncer, pin n = input n (GPIOB on 8 to 15). */
+    struct ButtonExpander* _next; 	/**< Next expander on the bus. */
+} ButtonExpander;
+
+/**
+ * @struct ButtonExpanderBus
+ *
+ * @brief Expanders sharing one I2C bus, read one at a time.
+ */
+typedef struct {
+    I2C_HandleTypeDef* hi2c; 		/**< Initialized I2C handle with its RX DMA linked. */
+    ButtonExpander* _expanders; 	/**< Expanders on the bus. */
+    ButtonExpander* volatile _current; /**< Expander being read, NULL if the bus is idle. */
+    volatile uint32_t _errors; 		/**< Failed transfers. */
+} ButtonExpanderBus;
+
+/**
+ * @brief Initializes an expander bus.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param hi2c Initialized I2C handle.
+ */
+void Button_Expander_Bus_Init(ButtonExpanderBus* bus, I2C_HandleTypeDef* hi2c);
+
+/**
+ * @brief Adds an expander to a bus and queues its first read.
+ *
+ * The expander must already be configured (inputs, pull-ups, interrupt on
+ * change), and must release INT when its inputs are read.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param expander Pointer to the ButtonExpander structure.
+ * @param address I2C address, shifted left.
+ * @param reg Input register, BUTTON_EXPANDER_NO_REG if none.
+ * @param size Bytes read, 1 or 2.
+ * @param int_port GPIO port of the INT line.
+ * @param int_pin EXTI pin of the INT line.
+ * @param active_low Mask of the inputs that read 0 when pressed.
+ */
+void Button_Expander_Init(ButtonExpanderBus* bus, ButtonExpander* expander, uint16_t address, uint16_t reg,
+                          uint8_t size, GPIO_TypeDef* int_port, uint16_t int_pin, uint16_t active_low);
+
+/**
+ * @brief Lets an expander drive a button.
+ *
+ * @param expander Pointer to the ButtonExpander structure.
+ * @param button Initialized button.
+ * @param input Expander input, 0 to 15.
+ * @return HAL_OK, or HAL_ERROR if the input does not exist.
+ */
+HAL_StatusTypeDef Button_Expander_Attach(ButtonExpander* expander, Button* button, uint8_t input);
+
+/**
+ * @brief Queues a read of the expanders on an INT line. Call from HAL_GPIO_EXTI_Callback.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param GPIO_Pin Interrupting pin; pins of no expander are ignored.
+ */
+void Button_Expander_Edge(ButtonExpanderBus* bus, uint16_t GPIO_Pin);
+
+/**
+ * @brief Debounces a finished read and starts the next one.
+ *
+ * Call from HAL_I2C_MemRxCpltCallback and HAL_I2C_MasterRxCpltCallback.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param hi2c Handle of the callback; other buses are ignored.
+ */
+void Button_Expander_Complete(ButtonExpanderBus* bus, I2C_HandleTypeDef* hi2c);
+
+/**
+ * @brief Drops a failed read, retried at the next tick. Call from HAL_I2C_ErrorCallback.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param hi2c Handle of the callback; other buses are ignored.
+ */
+void Button_Expander_Error(ButtonExpanderBus* bus, I2C_HandleTypeDef* hi2c);
+
+/**
+ * @brief Reads again the expanders still bouncing or in error.
+ *
+ * Call every BUTTON_PORT_TICK_MS, from SysTick_Handler or a timer interrupt.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ */
+void Button_Expander_Tick(ButtonExpanderBus* bus);
+
+/**
+ * @brief Returns the debounced state of an expander.
+ *
+ * @param expander Pointer to the ButtonExpander structure.
+ * @return Mask of the pressed inputs.
+ */
+uint32_t Button_Expander_State(ButtonExpander* expander);
+
+/**
+ * @brief Returns the number of failed transfers on a bus.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @return Error count since initialization.
+ */
+uint32_t Button_Expander_Errors(ButtonExpanderBus* bus);
+
+#endif /* BUTTON_EXPANDER_H */
@@ -0,0 +1,108 @@
+/**
+ * @file button_exti.h
+ *
+ * @brief EXTI dispatch and hardware-assisted debouncing of EXTI buttons.
+ *
+ * @details Buttons are registered in a flat table indexed by EXTI line.
+ * Button_Exti_IRQHandler reads EXTI->PR once and services every pending line
+ * of a vector in a single ISR entry, which also covers the shared EXTI9_5 and
+ * EXTI15_10 vectors; Button_Exti_Edge serves the same table from
+ * HAL_GPIO_EXTI_Callback. No switch to edit when adding buttons.
+ *
+ * With a re-arm timer, the first edge of a button is accepted immediately, then its EXTI
+ * line is masked (EXTI->IMR) so the contact bounce raises no interrupt. A
+ * compare channel of a free-running timer re-arms the line after the debounce
+ * delay of the button and re-reads the pin at that moment, catching any
+ * transition missed while masked. Optionally the trigger edge follows the
+ * button state (falling while released, rising while pressed), so each
+ * physical press costs one interrupt per transition.
+ *
+ * The timer is configured by the application as a free-running up counter at
+ * BUTTON_EXTI_TIMER_HZ with a period of 0xFFFF. Its IRQ handler must call
+ * Button_Exti_Timer_IRQHandler.
+ *
+ * With the BUTTON_FAST_ISR build option, the EXTI vectors of stm32f3xx_it.c
+ * skip the HAL chain and record the edges of the example buttons with the
+ * register-level Button_Defer_IRQHandler (button_defer.h).
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_EXTI_H
+#define BUTTON_EXTI_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+#define BUTTON_EXTI_LINES			16		/* GPIO EXTI lines 0 to 15 */
+
+/* Lines served by each EXTI vector, for Button_Exti_IRQHandler */
+#define BUTTON_EXTI_LINE(n)			(1U << (n))
+#define BUTTON_EXTI_LINES_9_5		0x03E0U
+#define BUTTON_EXTI_LINES_15_10		0xFC00U
+
+#ifndef BUTTON_EXTI_TIMER_HZ
+#define BUTTON_EXTI_TIMER_HZ		10000	/* Counting frequency of the re-arm timer */
+#endif
+
+
+/**
+ * @struct ButtonExti
+ *
+ * @brief EXTI lines of the buttons and their optional re-arm timer.
+ */
+typedef struct {
+    TIM_HandleTypeDef* htim; 		/**< Free-running timer used for re-arming, NULL for dispatch only. */
+    uint32_t channel; 				/**< Compare channel of the timer (TIM_CHANNEL_x). */
+    uint8_t _switch_edge; 			/**< 1 if the trigger edge follows the button state. */
+    volatile uint16_t _masked; 		/**< Lines currently masked for debouncing. */
+    uint16_t _deadline[BUTTON_EXTI_LINES]; /**< Timer count at which each masked line is re-armed. */
+    uint16_t _guard[BUTTON_EXTI_LINES]; /**< Debounce delay of each line, in timer counts. */
+    Button* _buttons[BUTTON_EXTI_LINES]; /**< Button on each line, NULL if none. */
+} ButtonExti;
+
+/**
+ * @brief Initializes the EXTI table and starts the re-arm timer, if any.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param htim Initialized free-running timer, or NULL to only dispatch edges.
+ * @param channel Compare channel used for re-arming (TIM_CHANNEL_x).
+ * @param switch_edge 1 to trigger on one edge only, following the button state.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Exti_Init(ButtonExti* exti, TIM_HandleTypeDef* htim, uint32_t channel,
+                                   uint8_t switch_edge);
+
+/**
+ * @brief Registers a button on its EXTI line, debounced by masking if there is a re-arm timer.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param button Button whose pin is configured as EXTI input.
+ */
+void Button_Exti_Attach(ButtonExti* exti, Button* button);
+
+/**
+ * @brief Handles an edge on a button line. Call from HAL_GPIO_EXTI_Callback.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param GPIO_Pin Pin of the interrupting line.
+ */
+BUTTON_CCM_CODE void Button_Exti_Edge(ButtonExti* exti, uint16_t GPIO_Pin);
+
+/**
+ * @brief Services all pending lines of an EXTI vector. Call from the EXTIx_IRQHandler.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param lines Lines of the vector (BUTTON_EXTI_LINE(n), BUTTON_EXTI_LINES_9_5...).
+ */
+BUTTON_CCM_CODE void Button_Exti_IRQHandler(ButtonExti* exti, uint32_t lines);
+
+/**
+ * @brief Re-arms the lines whose debounce delay expired. Call from the timer IRQ handler.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ */
+void Button_Exti_Timer_IRQHandler(ButtonExti* exti);
+
+#endif /* BUTTON_EXTI_H */
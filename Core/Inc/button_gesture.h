@@ -0,0 +1,115 @@
+/**
+ * @file button_gesture.h
+ *
+ * @brief Recognition of event sequences (gestures) with a finite automaton.
+ *
+ * @details An alphabet maps button events to symbols, e.g. {&swa, LONG} or
+ * {&swa, CLICK, 1}. Patterns are symbol strings with a time window, e.g.
+ * long-short-short within 3 s, or A,B,A within 2 s; both tables are const
+ * and can live in flash. Button_Gesture_Compile turns the patterns into a
+ * deterministic automaton (Aho-Corasick: a trie whose missing transitions
+ * follow the failure links), so a pattern is found wherever it starts in the
+ * event stream. Afterwards each event costs one transition table lookup.
+ *
+ * Events can be fed from a queue drain loop, or directly by subscribing
+ * Button_Gesture_Callback (button_callback.h) with the ButtonGesture as user
+ * pointer.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_GESTURE_H
+#define BUTTON_GESTURE_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+#ifndef BUTTON_GESTURE_SYMBOLS
+#define BUTTON_GESTURE_SYMBOLS		8		/* Maximum alphabet size */
+#endif
+
+#ifndef BUTTON_GESTURE_STATES
+#define BUTTON_GESTURE_STATES		32		/* Maximum automaton states, at most 255 */
+#endif
+
+#define BUTTON_GESTURE_LENGTH		8		/* Maximum pattern length */
+#define BUTTON_GESTURE_ANY			(-1)	/* Symbol value matching any event value */
+
+
+/**
+ * @struct ButtonGestureSymbol
+ *
+ * @brief Events mapped to one symbol.
+ */
+typedef struct {
+    const void* source; 			/**< Event source (e.g. &swa). */
+    uint8_t type; 					/**< One of ButtonEventType. */
+    int8_t value; 					/**< Event value, or BUTTON_GESTURE_ANY. */
+} ButtonGestureSymbol;
+
+/**
+ * @struct ButtonGesturePattern
+ *
+ * @brief One gesture.
+ */
+typedef struct {
+    const uint8_t* symbols; 		/**< Symbol indexes in the alphabet. */
+    uint8_t length; 				/**< Number of symbols, 1 to BUTTON_GESTURE_LENGTH. */
+    uint16_t window; 				/**< Longest time from the first to the last event, in milliseconds. */
+} ButtonGesturePattern;
+
+/**
+ * @struct ButtonGesture
+ *
+ * @brief Compiled recognizer and its position in the event stream.
+ */
+typedef struct {
+    const ButtonGestureSymbol* alphabet; /**< Symbol table. */
+    const ButtonGesturePattern* patterns; /**< Pattern table. */
+    ButtonQueue* queue; 			/**< Queue receiving GESTURE events, NULL if unused. */
+    uint8_t symbol_count; 			/**< Symbols in the alphabet. */
+    uint8_t pattern_count; 			/**< Patterns in the table. */
+    uint16_t gap; 					/**< Longest time between two events of a gesture, in milliseconds. */
+    uint8_t _next[BUTTON_GESTURE_STATES][BUTTON_GESTURE_SYMBOLS]; /**< Transition table. */
+    int8_t _accept[BUTTON_GESTURE_STATES]; /**< Pattern recognized in each state, -1 if none. */
+    uint8_t _state; 				/**< Current state. */
+    uint8_t _head; 					/**< Next entry of _times. */
+    uint8_t _valid; 				/**< Valid entries of _times. */
+    ButtonTime _times[BUTTON_GESTURE_LENGTH]; /**< Timestamps of the last events, circular. */
+} ButtonGesture;
+
+/**
+ * @brief Builds the automaton of a set of patterns.
+ *
+ * @param gesture Pointer to the ButtonGesture structure.
+ * @param alphabet Symbol table, kept by reference.
+ * @param symbol_count Symbols in the alphabet, at most BUTTON_GESTURE_SYMBOLS.
+ * @param patterns Pattern table, kept by reference.
+ * @param pattern_count Patterns in the table.
+ * @param gap_ms Longest time between two events of a gesture, in milliseconds.
+ * @param queue Queue receiving GESTURE events, or NULL.
+ * @return HAL_OK, or HAL_ERROR if the tables exceed the limits.
+ */
+HAL_StatusTypeDef Button_Gesture_Compile(ButtonGesture* gesture, const ButtonGestureSymbol* alphabet,
+                                         uint8_t symbol_count, const ButtonGesturePattern* patterns,
+                                         uint8_t pattern_count, uint16_t gap_ms, ButtonQueue* queue);
+
+/**
+ * @brief Feeds one event to the recognizer.
+ *
+ * @param gesture Pointer to the ButtonGesture structure.
+ * @param event Button event.
+ * @return Index of the pattern recognized by this event, -1 if none.
+ */
+int32_t Button_Gesture_Feed(ButtonGesture* gesture, const ButtonEvent* event);
+
+/**
+ * @brief ButtonCallback feeding a recognizer; subscribe it with the ButtonGesture as user pointer.
+ *
+ * @param event Button event.
+ * @param user Pointer to the ButtonGesture structure.
+ */
+void Button_Gesture_Callback(const ButtonEvent* event, void* user);
+
+#endif /* BUTTON_GESTURE_H */
@@ -0,0 +1,136 @@
+/**
+ * @file button_ladder.h
+ *
+ * @brief Resistor ladder buttons read by timer-triggered ADC conversions.
+ *
+ * @details Several buttons share one analog pin, each pulling it to its own
+ * voltage through a resistor ladder. A timer trigger converts all the ladder
+ * channels of one ADC as a sequence, and circular DMA stores
+ * BUTTON_LADDER_AVERAGE sequences before its single interrupt. The averaged
+ * code of each pin is decoded to the nearest level of its table, with
+ * hysteresis, and the decoded button goes through a port debouncer
+ * (button_port.h), so that the short intermediate levels crossed while a
+ * button moves are filtered and attached buttons get the usual events.
+ *
+ * The ADC is programmed through its registers, as the ADC HAL driver is not
+ * part of this project. The analog pins, the DMA channel (circular,
+ * half-word) and the timer (master output trigger on update) are configured
+ * by the application; the DMA IRQ handler must call HAL_DMA_IRQHandler.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_LADDER_H
+#define BUTTON_LADDER_H
+
+#include "stm32f3xx_hal.h"
+#include "button_port.h"
+
+
+#define BUTTON_LADDER_CHANNELS		4		/* Maximum ladders per ADC (regular sequence in SQR1) */
+#define BUTTON_LADDER_LEVELS		16		/* Maximum buttons per ladder */
+#define BUTTON_LADDER_AVERAGE		4		/* Sequences averaged per DMA interrupt */
+#define BUTTON_LADDER_NONE			0xFF	/* Decoded value when no button is pressed */
+
+#ifndef BUTTON_LADDER_SMP
+#define BUTTON_LADDER_SMP			5		/* Sampling time code, 61.5 ADC cycles */
+#endif
+
+#define BUTTON_LADDER_TIMEOUT_MS	2		/* ADC calibration and enable timeout */
+
+
+/**
+ * @struct ButtonLadder
+ *
+ * @brief Buttons on one analog pin.
+ */
+typedef struct {
+    uint8_t channel; 				/**< ADC channel of the pin, 1 to 18. */
+    const uint16_t* levels; 		/**< ADC code of each button, 12-bit. */
+    uint8_t count; 					/**< Number of buttons. */
+    uint16_t idle; 					/**< ADC code with no button pressed. */
+    uint16_t hysteresis; 			/**< Codes a reading must be closer to a new level to switch. */
+    uint16_t _code; 				/**< Last averaged code. */
+    uint8_t _current; 				/**< Decoded button, BUTTON_LADDER_NONE if none. */
+    ButtonPort _port; 				/**< Debouncer, pin n = button n. */
+} ButtonLadder;
+
+/**
+ * @struct ButtonLadderAdc
+ *
+ * @brief ADC converting the ladders of a regular sequence.
+ */
+typedef struct {
+    ADC_TypeDef* instance; 			/**< ADC1 to ADC4. */
+    DMA_HandleTypeDef* hdma; 		/**< Circular DMA channel of the ADC. */
+    TIM_HandleTypeDef* htim; 		/**< Timer triggering the conversions. */
+    ButtonLadder** _ladders; 		/**< Ladders, in sequence order. */
+    uint8_t _count; 				/**< Number of ladders. */
+    uint16_t _buffer[BUTTON_LADDER_AVERAGE * BUTTON_LADDER_CHANNELS]; /**< DMA buffer. */
+} ButtonLadderAdc;
+
+/**
+ * @brief Initializes a ladder.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @param channel ADC channel of the pin, 1 to 18.
+ * @param levels ADC code of each button, 12-bit.
+ * @param count Number of buttons, at most BUTTON_LADDER_LEVELS.
+ * @param idle ADC code with no button pressed.
+ * @param hysteresis Codes a reading must be closer to a new level to switch.
+ * @return HAL_OK, or HAL_ERROR if there are too many buttons.
+ */
+HAL_StatusTypeDef Button_Ladder_Init(ButtonLadder* ladder, uint8_t channel, const uint16_t* levels, uint8_t count,
+                                     uint16_t idle, uint16_t hysteresis);
+
+/**
+ * @brief Lets a ladder drive a button.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @param button Initialized button.
+ * @param index Index of the button in the level table.
+ * @return HAL_OK, or HAL_ERROR if the index is not in the level table.
+ */
+HAL_StatusTypeDef Button_Ladder_Attach(ButtonLadder* ladder, Button* button, uint8_t index);
+
+/**
+ * @brief Calibrates the ADC and starts the triggered conversions.
+ *
+ * @param adc Pointer to the ButtonLadderAdc structure.
+ * @param instance ADC1 to ADC4.
+ * @param ladders Ladders to convert, in sequence order; the array must stay valid.
+ * @param count Number of ladders, at most BUTTON_LADDER_CHANNELS.
+ * @param hdma Circular DMA channel of the ADC.
+ * @param htim Initialized timer with its update as trigger output.
+ * @param extsel External trigger of the timer TRGO (EXTSEL code, reference manual).
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Ladder_Start(ButtonLadderAdc* adc, ADC_TypeDef* instance, ButtonLadder** ladders,
+                                      uint8_t count, DMA_HandleTypeDef* hdma, TIM_HandleTypeDef* htim,
+                                      uint8_t extsel);
+
+/**
+ * @brief Stops the conversions and disables the ADC.
+ *
+ * @param adc Pointer to the ButtonLadderAdc structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Ladder_Stop(ButtonLadderAdc* adc);
+
+/**
+ * @brief Returns the button decoded from the last reading, before debouncing.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @return Button index, or BUTTON_LADDER_NONE.
+ */
+uint8_t Button_Ladder_Level(ButtonLadder* ladder);
+
+/**
+ * @brief Returns the last averaged ADC code, for level tuning.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @return 12-bit code.
+ */
+uint16_t Button_Ladder_Code(ButtonLadder* ladder);
+
+#endif /* BUTTON_LADDER_H */
@@ -0,0 +1,120 @@
+/**
+ * @file button_matrix.h
+ *
+ * @brief Row/column matrix keypads scanned by timer-triggered DMA.
+ *
+ * @details Two DMA channels paced by one timer do the whole scan: the update
+ * request writes the next row pattern to the row port BSRR (circular, word,
+ * memory to peripheral), and a compare request half a period later copies
+ * the column port IDR (circular, half-word, peripheral to memory). The CPU
+ * only sees one DMA interrupt per full scan, which yields the key bitmap.
+ * The bitmap goes through the port debouncer (button_port.h), two rows per
+ * virtual ButtonPort, so keys attached as Buttons get the usual events.
+ *
+ * Rows are driven low one at a time (open-drain outputs recommended) and the
+ * columns are inputs with pull-ups. Keypads from 1x1 to 8x8 are supported,
+ * rows and columns being the set bits of a pin mask, in bit order. Without
+ * diodes, keys on the corners of a rectangle cannot be told apart from a
+ * ghost: such scans are dropped and counted.
+ *
+ * The timer (dedicated, not started) and both DMA channels are configured
+ * by the application, the compare channel having its pulse at half the
+ * period. The column DMA IRQ handler must call HAL_DMA_IRQHandler.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_MATRIX_H
+#define BUTTON_MATRIX_H
+
+#include "stm32f3xx_hal.h"
+#include "button_port.h"
+
+
+#define BUTTON_MATRIX_ROWS			8		/* Maximum rows */
+#define BUTTON_MATRIX_COLS			8		/* Maximum columns */
+
+
+/**
+ * @struct ButtonMatrix
+ *
+ * @brief DMA scanned keypad. Key (row, col) is bit row * 8 + col of the bitmap.
+ */
+typedef struct {
+    GPIO_TypeDef* row_port; 		/**< GPIO port of the rows. */
+    GPIO_TypeDef* col_port; 		/**< GPIO port of the columns. */
+    uint16_t row_mask; 				/**< Row pins. */
+    uint16_t col_mask; 				/**< Column pins. */
+    TIM_HandleTypeDef* htim; 		/**< Timer pacing the scan. */
+    DMA_HandleTypeDef* hdma_rows; 	/**< DMA channel writing the rows. */
+    DMA_HandleTypeDef* hdma_cols; 	/**< DMA channel reading the columns. */
+    uint32_t _cols_request; 		/**< Timer DMA request of the column channel (TIM_DMA_CCx). */
+    uint8_t _rows; 					/**< Number of rows. */
+    uint32_t _ghosts; 				/**< Scans dropped because of ghosting. */
+    uint32_t _patterns[BUTTON_MATRIX_ROWS]; /**< BSRR values, rotated by one row. */
+    uint16_t _samples[BUTTON_MATRIX_ROWS]; /**< Column IDR of each row. */
+    ButtonPort _ports[BUTTON_MATRIX_ROWS / 2]; /**< Debouncers, two rows each. */
+} ButtonMatrix;
+
+/**
+ * @brief Initializes a keypad.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param row_port GPIO port of the rows.
+ * @param row_mask Row pins, at most 8.
+ * @param col_port GPIO port of the columns.
+ * @param col_mask Column pins, at most 8.
+ * @return HAL_OK, or HAL_ERROR if the keypad is too large.
+ */
+HAL_StatusTypeDef Button_Matrix_Init(ButtonMatrix* matrix, GPIO_TypeDef* row_port, uint16_t row_mask,
+                                     GPIO_TypeDef* col_port, uint16_t col_mask);
+
+/**
+ * @brief Lets the keypad drive a button.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param button Initialized button.
+ * @param row Row of the key.
+ * @param col Column of the key.
+ * @return HAL_OK, or HAL_ERROR if the key is outside the keypad.
+ */
+HAL_StatusTypeDef Button_Matrix_Attach(ButtonMatrix* matrix, Button* button, uint8_t row, uint8_t col);
+
+/**
+ * @brief Starts scanning.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param htim Initialized timer, not running.
+ * @param hdma_rows Circular DMA channel on the timer update request.
+ * @param hdma_cols Circular DMA channel on the timer compare request.
+ * @param cols_request Timer DMA request of hdma_cols (TIM_DMA_CC1...).
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Matrix_Start(ButtonMatrix* matrix, TIM_HandleTypeDef* htim, DMA_HandleTypeDef* hdma_rows,
+                                      DMA_HandleTypeDef* hdma_cols, uint32_t cols_request);
+
+/**
+ * @brief Stops scanning and releases the rows.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Matrix_Stop(ButtonMatrix* matrix);
+
+/**
+ * @brief Returns the debounced key bitmap.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @return Bit row * 8 + col set for each pressed key.
+ */
+uint64_t Button_Matrix_State(ButtonMatrix* matrix);
+
+/**
+ * @brief Returns the number of scans dropped because of ghosting.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @return Ghosted scans since initialization.
+ */
+uint32_t Button_Matrix_Ghosts(ButtonMatrix* matrix);
+
+#endif /* BUTTON_MATRIX_H */
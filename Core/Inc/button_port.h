@@ -0,0 +1,140 @@
+/**
+ * @file button_port.h
+ *
+ * @brief Port-level button debouncing for STM32.
+ *
+ * @details Debounces all 16 pins of a GPIO port at once from a single IDR
+ * read. Two engines are available, selected with BUTTON_PORT_ENGINE:
+ * - BUTTON_PORT_ENGINE_VERTICAL: vertical counters, bit n of each counter
+ *   plane holds one bit of the counter of pin n, so one tick is a handful of
+ *   word-wide logic operations whatever the number of buttons. A pin changes
+ *   state after BUTTON_PORT_SAMPLES identical samples.
+ * - BUTTON_PORT_ENGINE_INTEGRATOR: one 8-bit saturating integrator per pin,
+ *   updated four pins per instruction with the Cortex-M4 SIMD instructions.
+ *   Noise only delays the decision instead of restarting it, and each pin has
+ *   its own press/release thresholds.
+ * Buttons attached to a port receive the debounced state and generate their
+ * usual events.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_PORT_H
+#define BUTTON_PORT_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+#define BUTTON_PORT_PINS			16		/* Pins per port */
+#define BUTTON_PORT_SAMPLES			4		/* Identical samples needed to change state */
+#define BUTTON_PORT_TICK_MS			5		/* Suggested sampling period in milliseconds */
+
+#define BUTTON_PORT_ENGINE_VERTICAL		0
+#define BUTTON_PORT_ENGINE_INTEGRATOR	1
+
+#ifndef BUTTON_PORT_ENGINE
+#define BUTTON_PORT_ENGINE			BUTTON_PORT_ENGINE_VERTICAL
+#endif
+
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+#define BUTTON_PORT_STEP			32		/* Integrator change per sample */
+#define BUTTON_PORT_ON_THRESHOLD	192		/* Default level at which a pin becomes pressed */
+#define BUTTON_PORT_OFF_THRESHOLD	64		/* Default level at which a pin becomes released */
+#endif
+
+
+/**
+ * @struct ButtonPort
+ *
+ * @brief Debounce state of one GPIO port (or of 16 inputs from another source).
+ */
+typedef struct {
+    GPIO_TypeDef* GPIO_Port; 		/**< Sampled GPIO port, NULL if samples are pushed by the user. */
+    uint32_t _active_low; 			/**< Pins that read 0 when pressed. */
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+    uint32_t _level[BUTTON_PORT_PINS / 4]; /**< Integrators, one byte per pin. */
+    uint32_t _on[BUTTON_PORT_PINS / 4]; /**< Press thresholds, one byte per pin. */
+    uint32_t _off[BUTTON_PORT_PINS / 4]; /**< Release thresholds, one byte per pin. */
+#else
+    uint32_t _cnt0; 				/**< Vertical counter, bit 0 plane. */
+    uint32_t _cnt1; 				/**< Vertical counter, bit 1 plane. */
+#endif
+    uint32_t _state; 				/**< Debounced state, 1 = pressed. */
+    uint32_t _pressed; 				/**< Pins pressed during the last tick. */
+    uint32_t _released; 			/**< Pins released during the last tick. */
+    Button* _buttons[BUTTON_PORT_PINS]; /**< Buttons attached to each pin, NULL if none. */
+} ButtonPort;
+
+/**
+ * @brief Initializes a port debouncer.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param GPIO_Port GPIO port to sample, or NULL for samples pushed with Button_Port_Debounce.
+ * @param active_low Mask of the pins that read 0 when pressed.
+ */
+void Button_Port_Init(ButtonPort* port, GPIO_TypeDef* GPIO_Port, uint16_t active_low);
+
+/**
+ * @brief Lets a port debouncer drive a button.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param button Button initialized on the same port and pin.
+ */
+void Button_Port_Attach(ButtonPort* port, Button* button);
+
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+/**
+ * @brief Sets the integrator thresholds of some pins.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param pins Mask of the pins to configure.
+ * @param on Level at or above which a pin becomes pressed.
+ * @param off Level at or below which a pin becomes released (lower than on).
+ */
+void Button_Port_Set_Thresholds(ButtonPort* port, uint16_t pins, uint8_t on, uint8_t off);
+#endif
+
+/**
+ * @brief Debounces one sample of a port and updates the attached buttons.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param sample Raw pin levels.
+ * @param now Current time (Button_Time_Now).
+ * @return Mask of the pins whose debounced state changed.
+ */
+uint32_t Button_Port_Debounce(ButtonPort* port, uint32_t sample, ButtonTime now);
+
+/**
+ * @brief Samples and debounces an array of GPIO ports, one IDR read each.
+ *
+ * @param ports Array of ButtonPort structures.
+ * @param count Number of ports in the array.
+ */
+void Button_Port_Tick(ButtonPort* ports, uint32_t count);
+
+/**
+ * @brief Returns the debounced state of a port.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @return Mask of the pressed pins.
+ */
+uint32_t Button_Port_State(ButtonPort* port);
+
+/**
+ * @brief Returns the pins pressed during the last tick.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @return Mask of the newly pressed pins.
+ */
+uint32_t Button_Port_Pressed(ButtonPort* port);
+
+/**
+ * @brief Returns the pins released during the last tick.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @return Mask of the newly released pins.
+ */
+uint32_t Button_Port_Released(ButtonPort* port);
+
+#endif /* BUTTON_PORT_H */
@@ -0,0 +1,116 @@
+/**
+ * @file button_queue.h
+ *
+ * @brief Lock-free event queue between button interrupts and the main loop.
+ *
+ * @details Fixed-capacity, heap-free ring buffer of timestamped button events.
+ * Any number of interrupts (at any NVIC priority) may push events, using
+ * LDREX/STREX to reserve slots; a single consumer (usually the main loop)
+ * drains them in bulk. Events that do not fit are counted, not lost silently.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_QUEUE_H
+#define BUTTON_QUEUE_H
+
+#include "stm32f3xx_hal.h"
+#include "button_ccm.h"
+#include "button_time.h"
+
+
+#ifndef BUTTON_QUEUE_SIZE
+#define BUTTON_QUEUE_SIZE			32		/* Must be a power of two */
+#endif
+
+#if (BUTTON_QUEUE_SIZE & (BUTTON_QUEUE_SIZE - 1)) != 0
+#error "BUTTON_QUEUE_SIZE must be a power of two"
+#endif
+
+
+/**
+ * @enum ButtonEventType
+ *
+ * @brief Kinds of events carried by the queue.
+ */
+typedef enum {
+    BUTTON_EVENT_PRESS = 0,			/**< Button went down. */
+    BUTTON_EVENT_RELEASE,			/**< Button went up. */
+    BUTTON_EVENT_LONG,				/**< Button was held for LONG_PRESS_DURATION. */
+    BUTTON_EVENT_DOUBLE,			/**< Second press within DOUBLE_PRESS_WINDOW. */
+    BUTTON_EVENT_REPEAT,			/**< Auto-repeat while the button is held. */
+    BUTTON_EVENT_CLICK,				/**< End of a click sequence, value = number of clicks. */
+    BUTTON_EVENT_CHORD,				/**< Buttons pressed together, value = chord index (button_chord.h). */
+    BUTTON_EVENT_GESTURE,			/**< Event sequence recognized, value = pattern index (button_gesture.h). */
+    BUTTON_EVENT_ROTATE,			/**< Encoder turned, value = signed detents after acceleration (button_encoder.h). */
+} ButtonEventType;
+
+/**
+ * @struct ButtonEvent
+ *
+ * @brief One timestamped event.
+ */
+typedef struct {
+    ButtonTime timestamp; 			/**< Button_Time_Now() at detection. */
+    const void* source; 			/**< Object that produced the event (e.g. &swa). */
+    uint8_t type; 					/**< One of ButtonEventType. */
+    int8_t value; 					/**< Event argument, 0 when unused. */
+} ButtonEvent;
+
+/**
+ * @struct ButtonQueueSlot
+ *
+ * @brief Queue slot; the sequence number tells whether it is free or holds an event.
+ */
+typedef struct {
+    volatile uint32_t _seq; 		/**< Slot sequence number. */
+    ButtonEvent _event; 			/**< Stored event. */
+} ButtonQueueSlot;
+
+/**
+ * @struct ButtonQueue
+ *
+ * @brief Multi-producer, single-consumer event queue.
+ */
+typedef struct {
+    volatile uint32_t _head; 		/**< Next position reserved by a producer. */
+    volatile uint32_t _tail; 		/**< Next position read by the consumer. */
+    volatile uint32_t _overflow_count; /**< Number of events dropped because the queue was full. */
+    ButtonQueueSlot _slots[BUTTON_QUEUE_SIZE]; /**< Event storage. */
+} ButtonQueue;
+
+/**
+ * @brief Initializes an empty queue.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ */
+void Button_Queue_Init(ButtonQueue* queue);
+
+/**
+ * @brief Adds an event to the queue. Safe to call from any interrupt priority.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ * @param event Event to copy into the queue.
+ * @return 1 if the event was queued, 0 if the queue was full.
+ */
+BUTTON_CCM_CODE uint8_t Button_Queue_Push(ButtonQueue* queue, const ButtonEvent* event);
+
+/**
+ * @brief Removes up to max events from the queue. Single consumer only.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ * @param events Output array for the events, oldest first.
+ * @param max Capacity of the events array.
+ * @return Number of events copied to events.
+ */
+uint32_t Button_Queue_Drain(ButtonQueue* queue, ButtonEvent* events, uint32_t max);
+
+/**
+ * @brief Returns the number of events dropped because the queue was full.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ * @return Overflow count since initialization.
+ */
+uint32_t Button_Queue_Overflows(ButtonQueue* queue);
+
+#endif /* BUTTON_QUEUE_H */
@@ -0,0 +1,66 @@
+/**
+ * @file button_scan.h
+ *
+ * @brief Timer and DMA driven sampling of button ports.
+ *
+ * @details A timer request paces a circular DMA transfer of GPIOx->IDR into a
+ * double buffer, so the pins are sampled without any CPU work and without
+ * EXTI interrupts. On each DMA half/complete interrupt the finished half is
+ * reduced to one sample per pin (pins that did not stay stable over the whole
+ * half keep their debounced state) and handed to the port debouncer.
+ *
+ * The timer and DMA channel are configured by the application (e.g. with
+ * CubeMX): DMA peripheral to memory, circular, half-word, memory increment,
+ * linked to a timer request (TIM2_UP is DMA1 channel 2, TIM1_UP DMA1 channel
+ * 5...). The timer period sets the sampling rate, e.g. 4 kHz. Several ports
+ * can share the timer through its update and capture/compare requests to get
+ * consistent snapshots. The DMA IRQ handler must call HAL_DMA_IRQHandler.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_SCAN_H
+#define BUTTON_SCAN_H
+
+#include "stm32f3xx_hal.h"
+#include "button_port.h"
+
+
+#define BUTTON_SCAN_SAMPLES			16		/* Samples per half buffer */
+
+
+/**
+ * @struct ButtonScan
+ *
+ * @brief DMA sampling of one GPIO port.
+ */
+typedef struct {
+    TIM_HandleTypeDef* htim; 		/**< Timer pacing the samples. */
+    DMA_HandleTypeDef* hdma; 		/**< DMA channel copying the IDR. */
+    uint32_t _dma_request; 			/**< Timer DMA request used (TIM_DMA_UPDATE, TIM_DMA_CC1...). */
+    ButtonPort* _port; 				/**< Debouncer receiving the samples. */
+    uint16_t _buffer[2 * BUTTON_SCAN_SAMPLES]; /**< Circular double buffer of IDR samples. */
+} ButtonScan;
+
+/**
+ * @brief Starts sampling a port with a timer and a DMA channel.
+ *
+ * @param scan Pointer to the ButtonScan structure.
+ * @param htim Initialized timer; it is started by this function.
+ * @param dma_request Timer DMA request linked to the DMA channel (TIM_DMA_UPDATE, TIM_DMA_CC1...).
+ * @param hdma Initialized circular DMA channel.
+ * @param port Port debouncer, initialized with the GPIO port to sample.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Scan_Start(ButtonScan* scan, TIM_HandleTypeDef* htim, uint32_t dma_request,
+                                    DMA_HandleTypeDef* hdma, ButtonPort* port);
+
+/**
+ * @brief Stops the DMA transfer. The timer keeps running for other users.
+ *
+ * @param scan Pointer to the ButtonScan structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Scan_Stop(ButtonScan* scan);
+
+#endif /* BUTTON_SCAN_H */
@@ -0,0 +1,120 @@
+/**
+ * @file button_shift.h
+ *
+ * @brief Buttons on daisy-chained 74HC165 shift registers, clocked by DMA.
+ *
+ * @details The load and clock lines are bit-banged by DMA, without CPU work
+ * per bit: a timer update request writes the next load/clock pattern to the
+ * control port BSRR (circular, word, memory to peripheral), and a compare
+ * request half a period later copies the data port IDR (circular, half-word,
+ * peripheral to memory). One scan takes two timer periods per input, the
+ * first one loading the registers, and ends with a single DMA interrupt that
+ * feeds the inputs to port debouncers (button_port.h), 16 inputs each.
+ *
+ * Pick the timer period so that a scan lasts about BUTTON_PORT_TICK_MS:
+ * period = BUTTON_PORT_TICK_MS / (16 * chips). The clock inhibit input (CE)
+ * is tied low. Input n is the n-th bit shifted out: input H of the register
+ * driving the data pin is 0, its input A is 7, input H of the next register
+ * is 8...
+ *
+ * The timer (dedicated, not started) and both DMA channels are configured
+ * by the application, the compare channel having its pulse at half the
+ * period. The data DMA IRQ handler must call HAL_DMA_IRQHandler.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_SHIFT_H
+#define BUTTON_SHIFT_H
+
+#include "stm32f3xx_hal.h"
+#include "button_port.h"
+
+
+#ifndef BUTTON_SHIFT_CHIPS
+#define BUTTON_SHIFT_CHIPS			4		/* Maximum registers in the chain */
+#endif
+
+#define BUTTON_SHIFT_INPUTS			(8 * BUTTON_SHIFT_CHIPS)
+#define BUTTON_SHIFT_PERIODS		(2 * BUTTON_SHIFT_INPUTS)	/* Timer periods per scan */
+
+
+/**
+ * @struct ButtonShift
+ *
+ * @brief DMA clocked shift register chain.
+ */
+typedef struct {
+    GPIO_TypeDef* ctrl_port; 		/**< GPIO port of the load and clock lines. */
+    uint16_t load_pin; 				/**< SH/LD pin, loads while low. */
+    uint16_t clock_pin; 			/**< CLK pin, shifts on rising edges. */
+    GPIO_TypeDef* data_port; 		/**< GPIO port of the data line. */
+    uint16_t data_pin; 				/**< QH pin. */
+    TIM_HandleTypeDef* htim; 		/**< Timer pacing the clock. */
+    DMA_HandleTypeDef* hdma_ctrl; 	/**< DMA channel writing the control lines. */
+    DMA_HandleTypeDef* hdma_data; 	/**< DMA channel reading the data line. */
+    uint32_t _data_request; 		/**< Timer DMA request of the data channel (TIM_DMA_CCx). */
+    uint8_t _chips; 				/**< Registers in the chain. */
+    uint32_t _patterns[BUTTON_SHIFT_PERIODS]; /**< BSRR values, rotated by one period. */
+    uint16_t _samples[BUTTON_SHIFT_PERIODS]; /**< Data port IDR of each period. */
+    ButtonPort _ports[(BUTTON_SHIFT_INPUTS + 15) / 16]; /**< Debouncers, 16 inputs each. */
+} ButtonShift;
+
+/**
+ * @brief Initializes a shift register chain.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param chips Registers in the chain, 1 to BUTTON_SHIFT_CHIPS.
+ * @param ctrl_port GPIO port of the load and clock lines.
+ * @param load_pin SH/LD pin.
+ * @param clock_pin CLK pin.
+ * @param data_port GPIO port of the data line.
+ * @param data_pin QH pin.
+ * @param active_low 1 if the inputs read 0 when pressed.
+ * @return HAL_OK, or HAL_ERROR if the chain is too long.
+ */
+HAL_StatusTypeDef Button_Shift_Init(ButtonShift* shift, uint8_t chips, GPIO_TypeDef* ctrl_port, uint16_t load_pin,
+                                    uint16_t clock_pin, GPIO_TypeDef* data_port, uint16_t data_pin,
+                                    uint8_t active_low);
+
+/**
+ * @brief Lets the chain drive a button.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param button Initialized button.
+ * @param input Input of the chain.
+ * @return HAL_OK, or HAL_ERROR if the input is past the end of the chain.
+ */
+HAL_StatusTypeDef Button_Shift_Attach(ButtonShift* shift, Button* button, uint8_t input);
+
+/**
+ * @brief Starts scanning.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param htim Initialized timer, not running.
+ * @param hdma_ctrl Circular DMA channel on the timer update request.
+ * @param hdma_data Circular DMA channel on the timer compare request.
+ * @param data_request Timer DMA request of hdma_data (TIM_DMA_CC1...).
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Shift_Start(ButtonShift* shift, TIM_HandleTypeDef* htim, DMA_HandleTypeDef* hdma_ctrl,
+                                     DMA_HandleTypeDef* hdma_data, uint32_t data_request);
+
+/**
+ * @brief Stops scanning.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Shift_Stop(ButtonShift* shift);
+
+/**
+ * @brief Returns the debounced state of 16 inputs.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param first First input, multiple of 16.
+ * @return Bit n set if input first + n is pressed.
+ */
+uint32_t Button_Shift_State(ButtonShift* shift, uint8_t first);
+
+#endif /* BUTTON_SHIFT_H */
@@ -0,0 +1,72 @@
+/**
+ * @file button_time.h
+ *
+ * @brief Monotonic timebase of the button library.
+ *
+ * @details All button timing uses a 64-bit tick count that never wraps in
+ * practice, extended in software from one of these 32-bit counters, selected
+ * with BUTTON_TIMEBASE:
+ * - BUTTON_TIMEBASE_SYSTICK: HAL tick, 1 ms resolution.
+ * - BUTTON_TIMEBASE_DWT: DWT->CYCCNT cycle counter, BUTTON_CPU_HZ resolution.
+ * - BUTTON_TIMEBASE_TIM2: free-running 32-bit TIM2 at 1 MHz.
+ * Durations are converted to ticks at compile time with BUTTON_MS_TO_TICKS.
+ * Button_Time_Tick must run at least once per wrap of the 32-bit counter
+ * (about 59 s for the DWT at 72 MHz), e.g. from SysTick_Handler.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_TIME_H
+#define BUTTON_TIME_H
+
+#include "stm32f3xx_hal.h"
+#include "button_ccm.h"
+
+
+#define BUTTON_TIMEBASE_SYSTICK		0
+#define BUTTON_TIMEBASE_DWT			1
+#define BUTTON_TIMEBASE_TIM2		2
+
+#ifndef BUTTON_TIMEBASE
+#define BUTTON_TIMEBASE				BUTTON_TIMEBASE_SYSTICK
+#endif
+
+#ifndef BUTTON_CPU_HZ
+#define BUTTON_CPU_HZ				72000000	/* HCLK set by SystemClock_Config */
+#endif
+
+#if BUTTON_TIMEBASE == BUTTON_TIMEBASE_DWT
+#define BUTTON_TIME_HZ				BUTTON_CPU_HZ
+#elif BUTTON_TIMEBASE == BUTTON_TIMEBASE_TIM2
+#define BUTTON_TIME_HZ				1000000
+#else
+#define BUTTON_TIME_HZ				1000
+#endif
+
+/* Converts milliseconds to timebase ticks */
+#define BUTTON_MS_TO_TICKS(ms)		((ButtonTime)(ms) * (BUTTON_TIME_HZ / 1000))
+
+
+/**
+ * @brief Time in timebase ticks since start-up.
+ */
+typedef uint64_t ButtonTime;
+
+/**
+ * @brief Starts the selected counter (DWT or TIM2); nothing to do for the HAL tick.
+ */
+void Button_Time_Init(void);
+
+/**
+ * @brief Returns the current time. Safe to call from any context.
+ *
+ * @return Ticks since start-up.
+ */
+BUTTON_CCM_CODE ButtonTime Button_Time_Now(void);
+
+/**
+ * @brief Keeps the 64-bit extension up to date. Call periodically, e.g. from SysTick_Handler.
+ */
+void Button_Time_Tick(void);
+
+#endif /* BUTTON_TIME_H */
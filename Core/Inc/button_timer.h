@@ -0,0 +1,83 @@
+/**
+ * @file button_timer.h
+ *
+ * @brief Shared software timers of the button library.
+ *
+ * @details All the timed events of the buttons (long press while held,
+ * double press window, auto-repeat) are one-shot timers on a two-level
+ * hierarchical timer wheel driven by Button_Timer_Tick. Starting and
+ * cancelling a timer is O(1), and a tick only visits the timers that expire,
+ * plus one cascade of the upper level every BUTTON_TIMER_SLOTS ticks, so the
+ * cost does not grow with the number of buttons.
+ *
+ * Call Button_Timer_Tick every BUTTON_TIMER_TICK_MS, from SysTick_Handler or
+ * a timer interrupt; the timer callbacks run in that context.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_TIMER_H
+#define BUTTON_TIMER_H
+
+#include "stm32f3xx_hal.h"
+#include "button_ccm.h"
+
+
+#ifndef BUTTON_TIMER_TICK_MS
+#define BUTTON_TIMER_TICK_MS		1		/* Period of Button_Timer_Tick in milliseconds */
+#endif
+
+#define BUTTON_TIMER_BITS			6
+#define BUTTON_TIMER_SLOTS			(1U << BUTTON_TIMER_BITS)	/* Slots per wheel level */
+
+
+/**
+ * @brief Timer expiry callback.
+ *
+ * @param owner Owner pointer given to Button_Timer_Init.
+ */
+typedef void (*ButtonTimerCallback)(void* owner);
+
+/**
+ * @struct ButtonTimer
+ *
+ * @brief One-shot timer, linked in a wheel slot while running.
+ */
+typedef struct ButtonTimer {
+    struct ButtonTimer* _next; 		/**< Next timer of the slot. */
+    struct ButtonTimer** _link; 	/**< Pointer to this timer in the slot, NULL when stopped. */
+    uint32_t _expiry; 				/**< Tick at which the timer expires. */
+    ButtonTimerCallback _callback; 	/**< Called on expiry. */
+    void* _owner; 					/**< Passed to the callback. */
+} ButtonTimer;
+
+/**
+ * @brief Initializes a stopped timer.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ * @param callback Function called on expiry, from Button_Timer_Tick.
+ * @param owner Pointer passed to the callback.
+ */
+void Button_Timer_Init(ButtonTimer* timer, ButtonTimerCallback callback, void* owner);
+
+/**
+ * @brief Starts or restarts a timer.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ * @param ms Delay in milliseconds.
+ */
+BUTTON_CCM_CODE void Button_Timer_Start(ButtonTimer* timer, uint32_t ms);
+
+/**
+ * @brief Stops a timer. Does nothing if it is not running.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ */
+BUTTON_CCM_CODE void Button_Timer_Cancel(ButtonTimer* timer);
+
+/**
+ * @brief Advances the wheel by one tick and runs the expired timers.
+ */
+void Button_Timer_Tick(void);
+
+#endif /* BUTTON_TIMER_H */
@@ -0,0 +1,121 @@
+/**
+ * @file button_touch.h
+ *
+ * @brief Capacitive touch keys on the touch sensing controller (TSC).
+ *
+ * @details Each key is one channel IO of a TSC group and drives a Button, so
+ * touch keys produce the same events as mechanical ones. Keys of different
+ * groups are acquired together; keys sharing a group are acquired in turn.
+ * Button_Touch_Tick starts an acquisition when the previous one is over, the
+ * IOs discharging in between, and the end of acquisition interrupt updates
+ * each acquired key: a touch lowers the count below the baseline by at least
+ * the key threshold, and it is released when the drop gets under threshold
+ * minus hysteresis. The baseline follows slow drifts (temperature, humidity)
+ * while the key is released and is frozen while it is touched.
+ *
+ * The TSC IOs are configured by the application (alternate function 3,
+ * sampling IOs open-drain with their capacitor, channel IOs push-pull), and
+ * the EXTI2_TSC interrupt, shared with EXTI line 2, calls
+ * Button_Touch_IRQHandler.
+ *
+ * @author deligent4
+ */
+
+#ifndef BUTTON_TOUCH_H
+#define BUTTON_TOUCH_H
+
+#include "stm32f3xx_hal.h"
+#include "button.h"
+
+
+/* IO y (1 to 4) of TSC group x (1 to 8), for channels and sampling IOs */
+#define BUTTON_TOUCH_IO(x, y)		(1U << (((x) - 1) * 4 + (y) - 1))
+
+#ifndef BUTTON_TOUCH_CR
+/* Charge transfer 2+2 cycles of HCLK/32, max count 16383 */
+#define BUTTON_TOUCH_CR				((1U << TSC_CR_CTPH_Pos) | (1U << TSC_CR_CTPL_Pos) | \
+                                     (5U << TSC_CR_PGPSC_Pos) | (6U << TSC_CR_MCV_Pos))
+#endif
+
+#define BUTTON_TOUCH_FRACTION		4		/* Fractional bits of the baseline */
+#define BUTTON_TOUCH_DRIFT_SHIFT	6		/* Baseline tracking, 1/64 per acquisition */
+#define BUTTON_TOUCH_RISE_SHIFT		2		/* Faster tracking when the count rises above the baseline */
+
+
+/**
+ * @struct ButtonTouchKey
+ *
+ * @brief One touch key.
+ */
+typedef struct ButtonTouchKey {
+    Button* button; 				/**< Button driven by the key. */
+    uint32_t channel; 				/**< Channel IO (BUTTON_TOUCH_IO). */
+    uint16_t threshold; 			/**< Count drop at which the key is touched. */
+    uint16_t hysteresis; 			/**< Release at threshold - hysteresis. */
+    int32_t _baseline; 				/**< Untouched count, BUTTON_TOUCH_FRACTION fractional bits, 0 until the first acquisition. */
+    uint16_t _count; 				/**< Last count. */
+    uint8_t _phase; 				/**< Acquisition the key belongs to. */
+    uint8_t _touched; 				/**< Current state, 1 = touched. */
+    struct ButtonTouchKey* _next; 	/**< Next key. */
+} ButtonTouchKey;
+
+/**
+ * @struct ButtonTouch
+ *
+ * @brief Touch sensing controller and its keys.
+ */
+typedef struct {
+    uint32_t sampling; 				/**< Sampling IOs (BUTTON_TOUCH_IO), one per used group. */
+    ButtonTouchKey* _keys; 			/**< Keys. */
+    uint8_t _phases; 				/**< Acquisitions needed to read all keys. */
+    uint8_t _phase; 				/**< Acquisition in progress or next. */
+    volatile uint8_t _busy; 		/**< An acquisition is in progress. */
+} ButtonTouch;
+
+/**
+ * @brief Enables the TSC and its end of acquisition interrupt.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ * @param sampling Sampling IOs (BUTTON_TOUCH_IO), one per used group.
+ */
+void Button_Touch_Init(ButtonTouch* touch, uint32_t sampling);
+
+/**
+ * @brief Adds a key driving a button.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ * @param key Key storage, kept by the caller.
+ * @param button Initialized button.
+ * @param channel Channel IO (BUTTON_TOUCH_IO), in a group with a sampling IO.
+ * @param threshold Count drop at which the key is touched.
+ * @param hysteresis Release at threshold - hysteresis.
+ * @return HAL_OK, or HAL_ERROR if channel is not a single IO of a group with a sampling IO.
+ */
+HAL_StatusTypeDef Button_Touch_Attach(ButtonTouch* touch, ButtonTouchKey* key, Button* button, uint32_t channel,
+                                      uint16_t threshold, uint16_t hysteresis);
+
+/**
+ * @brief Starts the next acquisition if the previous one is over.
+ *
+ * Call every millisecond, from SysTick_Handler or a timer interrupt.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ */
+void Button_Touch_Tick(ButtonTouch* touch);
+
+/**
+ * @brief Handles the end of an acquisition. Call from EXTI2_TSC_IRQHandler.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ */
+void Button_Touch_IRQHandler(ButtonTouch* touch);
+
+/**
+ * @brief Returns the count drop of a key, for threshold tuning.
+ *
+ * @param key Pointer to the ButtonTouchKey structure.
+ * @return Baseline minus last count.
+ */
+int32_t Button_Touch_Delta(ButtonTouchKey* key);
+
+#endif /* BUTTON_TOUCH_H */
@@ -11,14 +11,17 @@
 
 
 #include "button.h"
+#include "button_callback.h"
 #include "main.h"
 
 
-uint8_t is_button_pressed;
-uint16_t debug_count, debounce_counter;
-static uint8_t is_state_changed;
-uint8_t button_has_changed;
-uint32_t double_window_counter;
+/* Index of a GPIO port in the AHB2 GPIO block (GPIOA = 0 ... GPIOF = 5) */
+#define BUTTON_PORT_INDEX(port)		((((uint32_t)(port)) - GPIOA_BASE) >> 10)
+#define BUTTON_PORT_COUNT			6
+
+
+static void Button_Timeout(void* owner);
+
 
 /**
  * @brief Initializes the button structure with GPIO port, pin, debounce time, initial state, and state change flag.
@@ -32,97 +35,424 @@ uint32_t double_window_counter;
 void Button_Init(Button* button, GPIO_TypeDef* GPIO_Port, uint16_t pin) {
     button->GPIO_Port = GPIO_Port;
     button->_pin = pin;
+    button->_delay = DEBOUNCE_DURATION;
     button->_state = GPIO_PIN_SET;
-    button->_has_changed = 0;
+    button->_source = BUTTON_SOURCE_PIN;
+    button->_events = 0;
+    button->_ignore_until = 0;
     button->_press_start_time = 0;
-    button->_long_press_event = 0;
-    button->_double_press_event = 0;
+    button->_last_press_time = 0;
+    button->_queue = NULL;
+    button->_subscriptions = NULL;
+    button->_long_sent = 0;
+    button->_click_gap = DOUBLE_PRESS_WINDOW;
+    button->_click_immediate = 0;
+    button->_clicks = 0;
+    button->_click_count = 0;
+    button->_repeat = NULL;
+    button->_repeat_next = 0;
+    button->_repeat_interval = 0;
+    button->_repeats = 0;
+    Button_Timer_Init(&button->_timer, Button_Timeout, button);
 }
 
 
 /**
- * @brief Handles button interrupts, including debouncing and detecting press events.
+ * @brief Sends the events of a button to a queue.
  *
- * This function is designed to be called in response to button interrupts.
- * Handles Single Press, Double Press and Long Press events.
+ * Events keep being reported through Button_Poll, Button_Pressed,
+ * Button_Long_Pressed and Button_Double_Pressed as well.
+ *
+ * @param button Pointer to the Button structure.
+ * @param queue Queue receiving the events, or NULL to stop queuing.
+ */
+void Button_Set_Queue(Button* button, ButtonQueue* queue) {
+    button->_queue = queue;
+}
+
+
+/**
+ * @brief Configures the click recognizer of a button.
+ *
+ * A click is a press released before LONG_PRESS_DURATION. Clicks separated
+ * by releases shorter than gap_ms form one sequence, reported as a single
+ * CLICK event carrying the number of clicks once the gap has elapsed. In
+ * immediate mode the first click is also reported at its release, for the
+ * lowest latency on single clicks. Needs Button_Timer_Tick.
+ *
+ * @param button Pointer to the Button structure.
+ * @param gap_ms Longest release between two clicks of a sequence, in milliseconds.
+ * @param immediate 1 to report CLICK(1) at the first release, 0 to wait for the end of the sequence.
+ */
+void Button_Set_Click(Button* button, uint16_t gap_ms, uint8_t immediate) {
+    button->_click_gap = gap_ms;
+    button->_click_immediate = immediate;
+}
+
+
+/**
+ * @brief Enables auto-repeat while the button is held.
+ *
+ * After repeat->delay of hold, REPEAT events are reported every interval,
+ * the interval being scaled by accel/256 after each one (256 keeps a
+ * constant rate) down to min_interval; the event value is the repeat count. A press that repeated
+ * is not a click. Needs Button_Timer_Tick.
+ *
+ * @param button Pointer to the Button structure.
+ * @param repeat Repeat curve (kept by reference), or NULL to disable.
+ */
+void Button_Set_Repeat(Button* button, const ButtonRepeat* repeat) {
+    button->_repeat = repeat;
+}
+
+
+/**
+ * @brief Returns the hold time of the next timed event of a held button.
+ *
+ * @param button Pointer to the Button structure.
+ * @return Hold time in milliseconds, 0 if nothing is left to time.
+ */
+static BUTTON_CCM_CODE uint32_t Button_Hold_Deadline(Button* button) {
+    uint32_t deadline = button->_long_sent ? 0 : LONG_PRESS_DURATION;
+
+    if (button->_repeat != NULL && (deadline == 0 || button->_repeat_next < deadline)) {
+        deadline = button->_repeat_next;
+    }
+    return deadline;
+}
+
+
+/**
+ * @brief Pushes an event of the button to its queue and its callbacks, if it has any.
+ *
+ * @param button Pointer to the Button structure.
+ * @param type One of ButtonEventType.
+ * @param value Event argument (number of clicks...), 0 when unused.
+ * @param timestamp Time at which the event was detected.
+ */
+static BUTTON_CCM_CODE void Button_Post_Event(Button* button, uint8_t type, int8_t value, ButtonTime timestamp) {
+    ButtonEvent event = { timestamp, button, type, value };
+
+    if (button->_queue != NULL) {
+        Button_Queue_Push(button->_queue, &event);
+    }
+    if (button->_subscriptions != NULL) {
+        Button_Callback_Notify(button, &event);
+    }
+}
+
+
+/**
+ * @brief Atomically adds events to the latched events of a button.
+ *
+ * The interrupt and the main loop can both update the same button, so a plain
+ * read-modify-write could lose events.
+ *
+ * @param button Pointer to the Button structure.
+ * @param events Mask of BUTTON_MASK_* bits to set.
+ */
+static BUTTON_CCM_CODE void Button_Latch_Events(Button* button, uint8_t events) {
+    uint8_t value;
+    do {
+        value = __LDREXB(&button->_events);
+    } while (__STREXB(value | events, &button->_events) != 0);
+}
+
+
+/**
+ * @brief Atomically reads and clears latched events of a button.
+ *
+ * @param button Pointer to the Button structure.
+ * @param mask Mask of BUTTON_MASK_* bits to consume.
+ * @return The consumed events that were set.
+ */
+static uint8_t Button_Take_Events(Button* button, uint8_t mask) {
+    uint8_t value;
+    do {
+        value = __LDREXB(&button->_events);
+    } while (__STREXB(value & ~mask, &button->_events) != 0);
+    return value & mask;
+}
+
+
+/**
+ * @brief Takes the right to report the LONG event of the current press.
+ *
+ * The timer and the release may race for it from different interrupts.
+ *
+ * @param button Pointer to the Button structure.
+ * @return 1 if the caller reports the event, 0 if it was already reported.
+ */
+static BUTTON_CCM_CODE uint8_t Button_Claim_Long(Button* button) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint8_t claimed = !button->_long_sent;
+    button->_long_sent = 1;
+    __set_PRIMASK(primask);
+    return claimed;
+}
+
+
+/**
+ * @brief Reports the CLICK event of a finished sequence, unless already reported.
+ *
+ * @param button Pointer to the Button structure.
+ * @param clicks Clicks of the sequence.
+ * @param timestamp Time of the event.
+ * @return BUTTON_MASK_CLICK if reported, 0 otherwise.
+ */
+static BUTTON_CCM_CODE uint8_t Button_Report_Clicks(Button* button, uint8_t clicks, ButtonTime timestamp) {
+    if (clicks == 0 || (clicks == 1 && button->_click_immediate)) {
+        return 0;
+    }
+    button->_click_count = clicks;
+    Button_Post_Event(button, BUTTON_EVENT_CLICK, (int8_t)clicks, timestamp);
+    return BUTTON_MASK_CLICK;
+}
+
+
+/**
+ * @brief Advances the state machine of a button with a new pin sample.
+ *
+ * Debounces the sample and detects Single Press, Double Press and Long Press
+ * events. All timing state lives in the Button itself, so a bounce on one
+ * button never locks out the others and any number of buttons can be timed
+ * in parallel. Buttons fed by a ButtonPort have a zero _delay, since their
+ * samples are already debounced. Long Press is reported by the button timer
+ * while the button is still held, or at release if Button_Timer_Tick is not
+ * running.
  *
  * @param button Pointer to the Button structure.
+ * @param current_state Sampled pin level.
+ * @param now Current time (Button_Time_Now).
+ * @return Mask of the BUTTON_MASK_* events detected by this sample.
  */
-void Button_IRQ_Handler(Button* button) {
-    static uint32_t ignore_until = 0;
-    static uint32_t press_start_time = 0;
-    static uint32_t last_press_time = 0;
-
-    if (ignore_until > HAL_GetTick()) {
-        // Ignore any changes during this period
-    } else {
-        uint8_t current_state = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
-
-        if (current_state != button->_state) {
-            // Update the debounce period and handle the state change
-            button->_state = current_state;
-            button->_has_changed = 1;  // Set the state change flag
-            button_has_changed = button->_has_changed;  // Added for debugging
-            debug_count++;  // Added for debugging
-            ignore_until = HAL_GetTick() + DEBOUNCE_DURATION;
-
-            if (current_state == GPIO_PIN_SET) {
-                // Button released
-                uint32_t press_duration = HAL_GetTick() - press_start_time;
-                if (press_duration >= LONG_PRESS_DURATION) {
-                    // Handle long press event
-                	button->_long_press_event = 1;
-                    // Reset the press start time
-                    press_start_time = 0;
+BUTTON_CCM_CODE uint8_t Button_Update(Button* button, GPIO_PinState current_state, ButtonTime now) {
+    uint8_t events = 0;
+
+    if (now < button->_ignore_until) {
+        // Ignore any changes on this button during its debounce period
+        return 0;
+    }
+
+    if (current_state != button->_state) {
+        // Update the debounce period and handle the state change
+        button->_state = current_state;
+        button->_ignore_until = now + BUTTON_MS_TO_TICKS(button->_delay);
+
+        if (current_state == GPIO_PIN_SET) {
+            // Button released
+            ButtonTime press_duration = now - button->_press_start_time;
+            Button_Timer_Cancel(&button->_timer);
+            events |= BUTTON_MASK_RELEASE;
+            Button_Post_Event(button, BUTTON_EVENT_RELEASE, 0, now);
+            if (press_duration >= BUTTON_LONG_PRESS_TICKS && Button_Claim_Long(button)) {
+                // Handle long press event, unless already reported while held
+                events |= BUTTON_MASK_LONG;
+                Button_Post_Event(button, BUTTON_EVENT_LONG, 0, now);
+            }
+            if (!button->_long_sent && button->_repeats == 0) {
+                // Count the click, the sequence ends when the gap timer expires;
+                // the count saturates at the largest event value
+                if (button->_clicks < INT8_MAX) {
+                    button->_clicks++;
                 }
-                if(press_duration < DOUBLE_PRESS_WINDOW){
-                	//Check for double press
-                	uint32_t time_since_last_press = press_start_time - last_press_time;
-                	if(time_since_last_press < DOUBLE_PRESS_WINDOW){
-                		// Handle double press event
-                		button->_double_press_event = 1;
-                	}
-                	// Record the last press time
-					last_press_time = press_start_time;
+                if (button->_clicks == 1 && button->_click_immediate) {
+                    button->_click_count = 1;
+                    events |= BUTTON_MASK_CLICK;
+                    Button_Post_Event(button, BUTTON_EVENT_CLICK, 1, now);
                 }
+                Button_Timer_Start(&button->_timer, button->_click_gap);
+            }
+            if (press_duration < BUTTON_DOUBLE_PRESS_TICKS) {
+                // Check for double press
+                ButtonTime time_since_last_press = button->_press_start_time - button->_last_press_time;
+                if (time_since_last_press < BUTTON_DOUBLE_PRESS_TICKS) {
+                    // Handle double press event
+                    events |= BUTTON_MASK_DOUBLE;
+                    Button_Post_Event(button, BUTTON_EVENT_DOUBLE, 0, now);
+                }
+                // Record the last press time
+                button->_last_press_time = button->_press_start_time;
+            }
+        } else {
+            // Button pressed
+            button->_press_start_time = now;
+            button->_long_sent = 0;
+            button->_repeats = 0;
+            if (button->_repeat != NULL) {
+                button->_repeat_next = button->_repeat->delay;
+                button->_repeat_interval = button->_repeat->interval;
+            }
+            Button_Timer_Start(&button->_timer, Button_Hold_Deadline(button));
+            events |= BUTTON_MASK_PRESS;
+            Button_Post_Event(button, BUTTON_EVENT_PRESS, 0, now);
+        }
+
+        Button_Latch_Events(button, events);
+    }
+    return events;
+}
+
+
+/**
+ * @brief Timer callback of a button.
+ *
+ * While held, the long press threshold or the next auto-repeat was reached:
+ * any pending click sequence ends, LONG or REPEAT is reported and the timer
+ * is restarted for the next of them. While released, the click gap elapsed
+ * and the sequence is reported. A timer restarted by an edge since it
+ * expired is stale and ignored.
+ *
+ * @param owner Pointer to the Button structure.
+ */
+static void Button_Timeout(void* owner) {
+    Button* button = owner;
+    ButtonTime now = Button_Time_Now();
+    uint8_t events = 0;
+    uint8_t clicks = 0;
+    uint8_t repeats = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (button->_timer._link == NULL) {
+        if (button->_state == GPIO_PIN_RESET) {
+            uint32_t held_ms = (uint32_t)((now - button->_press_start_time) / (BUTTON_TIME_HZ / 1000));
+
+            if (!button->_long_sent && held_ms >= LONG_PRESS_DURATION) {
+                button->_long_sent = 1;
+                events |= BUTTON_MASK_LONG;
+            }
+            if (button->_repeat != NULL && held_ms >= button->_repeat_next) {
+                const ButtonRepeat* repeat = button->_repeat;
+                uint32_t interval = button->_repeat_interval;
 
+                if (button->_repeats < INT8_MAX) {
+                    button->_repeats++;
+                }
+                repeats = button->_repeats;
+                button->_repeat_next += interval;
+                interval = (interval * repeat->accel) >> 8;
+                if (interval > UINT16_MAX) {
+                    interval = UINT16_MAX;
+                }
+                button->_repeat_interval = (interval < repeat->min_interval) ? repeat->min_interval : interval;
+                events |= BUTTON_MASK_REPEAT;
+            }
+            if (events != 0) {
+                clicks = button->_clicks;
+                button->_clicks = 0;
+            }
 
-            } else {
-                // Button pressed
-                press_start_time = HAL_GetTick();
+            uint32_t deadline = Button_Hold_Deadline(button);
+            if (deadline != 0) {
+                Button_Timer_Start(&button->_timer, (deadline > held_ms) ? deadline - held_ms : 1);
             }
+        } else {
+            clicks = button->_clicks;
+            button->_clicks = 0;
         }
     }
+    __set_PRIMASK(primask);
+
+    events |= Button_Report_Clicks(button, clicks, now);
+    if (events & BUTTON_MASK_LONG) {
+        Button_Post_Event(button, BUTTON_EVENT_LONG, 0, now);
+    }
+    if (events & BUTTON_MASK_REPEAT) {
+        Button_Post_Event(button, BUTTON_EVENT_REPEAT, (int8_t)repeats, now);
+    }
+    if (events != 0) {
+        Button_Latch_Events(button, events);
+    }
 }
 
 
 /**
- * @brief Reads the current state of the button.
+ * @brief Handles button interrupts, including debouncing and detecting press events.
  *
- * This function reads the state of the button's GPIO pin.
+ * This function is designed to be called in response to button interrupts.
+ * Handles Single Press, Double Press and Long Press events.
+ * Buttons fed by a ButtonPort are not sampled here.
  *
  * @param button Pointer to the Button structure.
- * @return GPIO_PIN_RESET if the button is pressed, GPIO_PIN_SET if the button is released.
  */
-static uint8_t Button_Read(Button* button) {
-    return HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+BUTTON_CCM_CODE void Button_IRQ_Handler(Button* button) {
+    if (button->_source == BUTTON_SOURCE_PIN) {
+        Button_Update(button, HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin), Button_Time_Now());
+    }
 }
 
 
 /**
- * @brief Checks if the button state has changed since the last check.
+ * @brief Samples one button and returns all its pending events.
+ *
+ * Replaces a sequence of Button_Pressed, Button_Long_Pressed and
+ * Button_Double_Pressed calls with a single pin read and state machine step.
+ * Events latched by the interrupt since the last call are returned too.
  *
- *	This Function is also used to get the Single Button Press events.
  * @param button Pointer to the Button structure.
- * @return 1 if the button state has changed(or button is pressed), 0 otherwise.
+ * @return Mask of BUTTON_MASK_* events.
  */
-static uint8_t Button_Has_Changed(Button* button) {
-    if (button->_has_changed) {
-        // Clear the state change flag
-    	button->_has_changed = 0;
-        return 1;
+uint8_t Button_Poll(Button* button) {
+    Button_IRQ_Handler(button);
+    return Button_Take_Events(button, BUTTON_MASK_ALL);
+}
+
+
+/**
+ * @brief Samples an array of buttons and returns the pending events of each.
+ *
+ * Each GPIO port used by the buttons is read once through its IDR register,
+ * and the time is read once, so the cost is one state machine step per button.
+ *
+ * @param buttons Array of Button structures.
+ * @param count Number of buttons in the array.
+ * @param events_out Receives the BUTTON_MASK_* events of each button.
+ * @return OR of all the returned event masks, 0 if nothing happened.
+ */
+uint8_t Button_PollAll(Button* buttons, uint32_t count, uint8_t* events_out) {
+    uint32_t idr[BUTTON_PORT_COUNT];
+    uint8_t idr_valid = 0;
+    uint8_t all_events = 0;
+    ButtonTime now = Button_Time_Now();
+
+    for (uint32_t i = 0; i < count; i++) {
+        Button* button = &buttons[i];
+
+        if (button->_source == BUTTON_SOURCE_PIN) {
+            uint32_t port = BUTTON_PORT_INDEX(button->GPIO_Port);
+
+            if ((idr_valid & (1U << port)) == 0) {
+                // First button on this port, take the snapshot shared by the others
+                idr[port] = button->GPIO_Port->IDR;
+                idr_valid |= (1U << port);
+            }
+
+            GPIO_PinState level = (idr[port] & button->_pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+            Button_Update(button, level, now);
+        }
+        events_out[i] = Button_Take_Events(button, BUTTON_MASK_ALL);
+        all_events |= events_out[i];
     }
-    return 0;
+    return all_events;
+}
+
+
+/**
+ * @brief Reads the current state of the button.
+ *
+ * This function reads the state of the button's GPIO pin, or returns the
+ * debounced state for buttons fed by a ButtonPort.
+ *
+ * @param button Pointer to the Button structure.
+ * @return GPIO_PIN_RESET if the button is pressed, GPIO_PIN_SET if the button is released.
+ */
+static uint8_t Button_Read(Button* button) {
+    if (button->_source != BUTTON_SOURCE_PIN) {
+        return button->_state;
+    }
+    return HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
 }
 
 
@@ -136,8 +466,8 @@ uint8_t Button_Pressed(Button* button) {
     Button_IRQ_Handler(button);
 
     // Check if there is a state change AND the button is currently pressed
-    is_state_changed = Button_Has_Changed(button);
-    is_button_pressed = (Button_Read(button) == GPIO_PIN_RESET);
+    uint8_t is_state_changed = (Button_Take_Events(button, BUTTON_MASK_PRESS | BUTTON_MASK_RELEASE) != 0);
+    uint8_t is_button_pressed = (Button_Read(button) == GPIO_PIN_RESET);
 
     return is_state_changed && is_button_pressed;
 }
@@ -152,13 +482,8 @@ uint8_t Button_Pressed(Button* button) {
 uint8_t Button_Long_Pressed(Button* button) {
     Button_IRQ_Handler(button);
 
-    // Check if there is a long press event
-    if(button->_long_press_event){
-    	//CLear the flag and return
-    	button->_long_press_event = 0;
-    	return 1;
-    }
-    return 0;
+    // Check and clear the long press event
+    return Button_Take_Events(button, BUTTON_MASK_LONG) != 0;
 }
 
 
@@ -171,13 +496,21 @@ uint8_t Button_Long_Pressed(Button* button) {
 uint8_t Button_Double_Pressed(Button* button) {
     Button_IRQ_Handler(button);
 
-    // Check if there is a long press event
-    if(button->_double_press_event){
-    	//CLear the flag and return
-    	button->_double_press_event = 0;
-    	return 1;
-    }
-    return 0;
+    // Check and clear the double press event
+    return Button_Take_Events(button, BUTTON_MASK_DOUBLE) != 0;
+}
+
+
+/**
+ * @brief Returns the number of clicks of the last reported click sequence.
+ *
+ * Read it when Button_Poll returns BUTTON_MASK_CLICK.
+ *
+ * @param button Pointer to the Button structure.
+ * @return Value of the last CLICK event, 0 if none yet.
+ */
+uint8_t Button_Clicks(Button* button) {
+    return button->_click_count;
 }
 
 
@@ -197,11 +530,11 @@ Flow of the program when the user presses the SWA button.
    (either falling or rising edge, depending on your button connection).
    - The `HAL_GPIO_EXTI_Callback` function is called due to the interrupt.
    - The `Button_IRQ_Handler` function is invoked for SWA,
-   detecting the button press, updating `ignore_until`, and setting `_has_changed` to 1.
+   detecting the button press, updating `_ignore_until`, and latching BUTTON_MASK_PRESS in `_events`.
 
 5. **Button_Pressed Check:**
    - The main loop checks for a pressed state using `Button_Pressed(&swa)`.
-   - `Button_IRQ_Handler` is called again (to update debounce and `_has_changed`).
+   - `Button_IRQ_Handler` is called again (to update debounce and `_events`).
    - The function returns `1` because the button is pressed and has changed state.
 
 6. **Handle Press Event (SWA Pressed):**
@@ -214,11 +547,11 @@ Flow of the program when the user presses the SWA button.
    - The corresponding EXTI interrupt is triggered again (opposite edge).
    - The `HAL_GPIO_EXTI_Callback` function is called due to the interrupt.
    - The `Button_IRQ_Handler` function is invoked for SWA,
-   detecting the button release, updating `_ignore_until`, and setting `_has_changed` to 1.
+   detecting the button release, updating `_ignore_until`, and latching BUTTON_MASK_RELEASE in `_events`.
 
 8. **Button_Released Check:**
    - The main loop checks for a released state using `Button_Released(&swa)`.
-   - `Button_IRQ_Handler` is called again (to update debounce and `_has_changed`).
+   - `Button_IRQ_Handler` is called again (to update debounce and `_events`).
    - The function returns `1` because the button is released and has changed state.
 
 9. **Handle Release Event (SWA Released):**
@@ -0,0 +1,190 @@
+/**
+ * @file button_bench.c
+ *
+ * @brief Cycle-count benchmarks of the button library.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_bench.h"
+
+#ifdef BUTTON_BENCHMARK
+
+#include "button_port.h"
+#include "button_exti.h"
+#include "stm32f3xx_ll_exti.h"
+
+
+/**
+ * @brief Small xorshift generator producing chattering pin samples.
+ *
+ * @param seed Generator state.
+ * @return Next pseudo-random word.
+ */
+static uint32_t Button_Bench_Random(uint32_t* seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+
+/**
+ * @brief Measures the port debounce engine selected by BUTTON_PORT_ENGINE.
+ *
+ * The random samples are generated before the measurement, so only the
+ * debounce itself is counted.
+ *
+ * @param iterations Number of ticks to average over.
+ * @return Average CPU cycles per tick for the 32 pins.
+ */
+uint32_t Button_Bench_Port_Debounce(uint32_t iterations) {
+    static ButtonPort ports[2];
+    uint32_t seed = 0x12345678;
+    uint32_t total = 0;
+
+    Button_Bench_Init();
+    Button_Port_Init(&ports[0], NULL, 0xFFFF);
+    Button_Port_Init(&ports[1], NULL, 0xFFFF);
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t sample = Button_Bench_Random(&seed);
+
+        uint32_t start = Button_Bench_Cycles();
+        Button_Port_Debounce(&ports[0], sample, i);
+        Button_Port_Debounce(&ports[1], sample >> 16, i);
+        total += Button_Bench_Cycles() - start;
+    }
+    return iterations ? total / iterations : 0;
+}
+
+
+
+/**
+ * @brief Returns the NVIC vector of a GPIO EXTI line.
+ *
+ * @param line EXTI line, 0 to 15.
+ * @return Interrupt number.
+ */
+static IRQn_Type Button_Bench_Exti_IRQn(uint32_t line) {
+    static const IRQn_Type vectors[5] = {EXTI0_IRQn, EXTI1_IRQn, EXTI2_TSC_IRQn, EXTI3_IRQn, EXTI4_IRQn};
+
+    if (line < 5) {
+        return vectors[line];
+    }
+    return (line < 10) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+
+/**
+ * @brief Deferred handler of the HAL path, as HAL_GPIO_EXTI_Callback only gets the pin.
+ */
+static ButtonDefer* bench_defer;
+
+
+/**
+ * @brief HAL_GPIO_EXTI_Callback of the example, deferring the edge.
+ *
+ * Kept out of line, as the real callback is called from the HAL driver.
+ *
+ * @param GPIO_Pin Pin of the interrupting line.
+ */
+static __attribute__((noinline)) void Button_Bench_HAL_Callback(uint16_t GPIO_Pin) {
+    Button_Defer_Edge(bench_defer, GPIO_Pin);
+}
+
+
+/**
+ * @brief Edge handler written with the HAL drivers, as HAL_GPIO_EXTI_IRQHandler.
+ *
+ * @param pin Pin of the interrupting line.
+ */
+static void Button_Bench_HAL_Edge(uint16_t pin) {
+    if (__HAL_GPIO_EXTI_GET_IT(pin) != 0x00U) {
+        __HAL_GPIO_EXTI_CLEAR_IT(pin);
+        Button_Bench_HAL_Callback(pin);
+    }
+}
+
+
+/**
+ * @brief Edge handler written with the LL drivers.
+ *
+ * @param defer Deferred handler the button is attached to.
+ * @param pin Pin of the interrupting line.
+ */
+static void Button_Bench_LL_Edge(ButtonDefer* defer, uint32_t pin) {
+    if (LL_EXTI_IsActiveFlag_0_31(pin)) {
+        LL_EXTI_ClearFlag_0_31(pin);
+        Button_Defer_Edge(defer, pin);
+    }
+}
+
+
+/**
+ * @brief Measures the top half of an EXTI edge through the HAL, LL and register paths.
+ *
+ * The vector is disabled in the NVIC and the edges are raised with
+ * EXTI->SWIER, so each path is called from thread mode on a real pending
+ * line. The exception entry and exit (about 12 cycles each) are the same for
+ * all paths and not counted. All paths acknowledge the line, record the edge
+ * in the defer ring and pend PendSV, as the vectors of stm32f3xx_it.c do with
+ * and without BUTTON_FAST_ISR. PendSV is masked during the measurement, so
+ * the bottom half runs once at the end, outside the timed window. Run it
+ * before the buttons are used. Run it in builds with and without
+ * BUTTON_CCMRAM to compare flash and CCMRAM.
+ *
+ * @param defer Deferred handler the button is attached to.
+ * @param button Button on an EXTI line, pin at rest.
+ * @param iterations Number of edges to average over.
+ * @param result Average CPU cycles per edge of each path.
+ */
+void Button_Bench_Edge(ButtonDefer* defer, Button* button, uint32_t iterations, ButtonBenchEdge* result) {
+    uint32_t pin = button->_pin;
+    IRQn_Type irq = Button_Bench_Exti_IRQn(__CLZ(__RBIT(pin)));
+    uint32_t enabled = NVIC_GetEnableIRQ(irq);
+    uint32_t imr = EXTI->IMR & pin;
+    uint32_t basepri = __get_BASEPRI();
+    uint32_t hal = 0, ll = 0, reg = 0;
+
+    Button_Bench_Init();
+    bench_defer = defer;
+    NVIC_DisableIRQ(irq);
+    EXTI->IMR |= pin;  // SWIER only sets PR on unmasked lines
+    __set_BASEPRI(NVIC_GetPriority(PendSV_IRQn) << (8U - __NVIC_PRIO_BITS));
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t start;
+
+        EXTI->SWIER = pin;
+        start = Button_Bench_Cycles();
+        Button_Bench_HAL_Edge(pin);
+        hal += Button_Bench_Cycles() - start;
+
+        EXTI->SWIER = pin;
+        start = Button_Bench_Cycles();
+        Button_Bench_LL_Edge(defer, pin);
+        ll += Button_Bench_Cycles() - start;
+
+        EXTI->SWIER = pin;
+        start = Button_Bench_Cycles();
+        Button_Defer_IRQHandler(defer, pin);
+        reg += Button_Bench_Cycles() - start;
+    }
+
+    __set_BASEPRI(basepri);
+    EXTI->IMR = (EXTI->IMR & ~pin) | imr;
+    NVIC_ClearPendingIRQ(irq);
+    if (enabled) {
+        NVIC_EnableIRQ(irq);
+    }
+
+    result->hal = iterations ? hal / iterations : 0;
+    result->ll = iterations ? ll / iterations : 0;
+    result->reg = iterations ? reg / iterations : 0;
+}
+
+#endif /* BUTTON_BENCHMARK */
@@ -0,0 +1,150 @@
+/**
+ * @file button_callback.c
+ *
+ * @brief Event callbacks of buttons, run in a chosen execution context.
+ *
+ * @details An event is queued once per context that has a matching
+ * subscription, not once per subscription; the dispatcher then walks the
+ * subscriptions of the button again. The subscription lists are changed with
+ * interrupts disabled, as they are walked from interrupts.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_callback.h"
+
+
+#define BUTTON_CALLBACK_BATCH		8		/* Events drained per queue access */
+
+static ButtonQueue button_callback_queues[2] BUTTON_CCM_DATA;	/* Deferred and main-loop events */
+
+
+/**
+ * @brief Initializes the deferred and main-loop event queues.
+ *
+ * PendSV gets the lowest priority, so deferred callbacks never delay another
+ * interrupt.
+ */
+void Button_Callback_Init(void) {
+    Button_Queue_Init(&button_callback_queues[0]);
+    Button_Queue_Init(&button_callback_queues[1]);
+    NVIC_SetPriority(PendSV_IRQn, (1U << __NVIC_PRIO_BITS) - 1);
+}
+
+
+/**
+ * @brief Registers a callback for some events of a button.
+ *
+ * @param button Pointer to the Button structure.
+ * @param subscription Subscription storage, owned by the caller until unsubscribed.
+ * @param mask BUTTON_MASK_* events to deliver.
+ * @param context Context the callback runs in.
+ * @param callback Function called for each event.
+ * @param user User pointer passed to the callback.
+ */
+void Button_Subscribe(Button* button, ButtonSubscription* subscription, uint8_t mask, ButtonContext context,
+                      ButtonCallback callback, void* user) {
+    subscription->callback = callback;
+    subscription->user = user;
+    subscription->_mask = mask;
+    subscription->_context = context;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    subscription->_next = button->_subscriptions;
+    button->_subscriptions = subscription;
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Removes a callback of a button.
+ *
+ * Events already queued for it are dropped.
+ *
+ * @param button Pointer to the Button structure.
+ * @param subscription Subscription given to Button_Subscribe.
+ */
+void Button_Unsubscribe(Button* button, ButtonSubscription* subscription) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (ButtonSubscription** link = &button->_subscriptions; *link != NULL; link = &(*link)->_next) {
+        if (*link == subscription) {
+            *link = subscription->_next;
+            break;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Delivers an event of a button to its subscriptions.
+ *
+ * ISR subscriptions are called at once; the event is queued for the other
+ * contexts, and PendSV is pended for deferred ones.
+ *
+ * @param button Pointer to the Button structure.
+ * @param event Detected event.
+ */
+BUTTON_CCM_CODE void Button_Callback_Notify(Button* button, const ButtonEvent* event) {
+    uint8_t bit = 1U << event->type;
+    uint8_t contexts = 0;
+
+    for (ButtonSubscription* subscription = button->_subscriptions; subscription != NULL;
+         subscription = subscription->_next) {
+        if (subscription->_mask & bit) {
+            if (subscription->_context == BUTTON_CONTEXT_ISR) {
+                subscription->callback(event, subscription->user);
+            } else {
+                contexts |= 1U << subscription->_context;
+            }
+        }
+    }
+
+    if (contexts & (1U << BUTTON_CONTEXT_DEFERRED)) {
+        Button_Queue_Push(&button_callback_queues[0], event);
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+    if (contexts & (1U << BUTTON_CONTEXT_MAIN)) {
+        Button_Queue_Push(&button_callback_queues[1], event);
+    }
+}
+
+
+/**
+ * @brief Runs the callbacks queued for a context.
+ *
+ * @param context BUTTON_CONTEXT_DEFERRED from PendSV_Handler, BUTTON_CONTEXT_MAIN from the main loop.
+ */
+void Button_Callback_Dispatch(ButtonContext context) {
+    ButtonQueue* queue = &button_callback_queues[context == BUTTON_CONTEXT_MAIN];
+    ButtonEvent events[BUTTON_CALLBACK_BATCH];
+    uint32_t count;
+
+    while ((count = Button_Queue_Drain(queue, events, BUTTON_CALLBACK_BATCH)) != 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            Button* button = (Button*)events[i].source;
+            uint8_t bit = 1U << events[i].type;
+
+            for (ButtonSubscription* subscription = button->_subscriptions; subscription != NULL;
+                 subscription = subscription->_next) {
+                if (subscription->_context == context && (subscription->_mask & bit)) {
+                    subscription->callback(&events[i], subscription->user);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Returns the number of events dropped because a context queue was full.
+ *
+ * @param context BUTTON_CONTEXT_DEFERRED or BUTTON_CONTEXT_MAIN.
+ * @return Overflow count since initialization.
+ */
+uint32_t Button_Callback_Overflows(ButtonContext context) {
+    return Button_Queue_Overflows(&button_callback_queues[context == BUTTON_CONTEXT_MAIN]);
+}
@@ -0,0 +1,151 @@
+/**
+ * @file button_capture.c
+ *
+ * @brief Timer input capture button inputs.
+ *
+ * @details Both edges are captured, so the direction of each edge is
+ * deduced by alternation from the level at start-up. If edges were lost
+ * (buffer wrapped between two calls), the level is re-read from the pin once
+ * the input has been quiet for the debounce delay.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_capture.h"
+
+
+/**
+ * @brief Converts a captured timer count to the time base.
+ *
+ * The age of the edge in timer counts is subtracted from the current time,
+ * so the result keeps the resolution of the capture.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @param edge Captured timer count.
+ * @return Time of the edge (Button_Time_Now scale).
+ */
+static ButtonTime Button_Capture_Edge_Time(ButtonCapture* capture, uint32_t edge) {
+    uint32_t age = __HAL_TIM_GET_COUNTER(capture->htim) - edge;
+    ButtonTime now = Button_Time_Now();
+    ButtonTime ticks = (ButtonTime)age * BUTTON_TIME_HZ / BUTTON_CAPTURE_TIMER_HZ;
+
+    return (ticks < now) ? now - ticks : 0;
+}
+
+
+/**
+ * @brief Commits the pending raw level to the button, at the time of its edge.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @return Mask of the BUTTON_MASK_* events produced.
+ */
+static uint8_t Button_Capture_Commit(ButtonCapture* capture) {
+    ButtonTime time = Button_Capture_Edge_Time(capture, capture->_last_edge);
+    uint8_t events = Button_Update(capture->button, capture->_raw, time);
+
+    if (events & BUTTON_MASK_PRESS) {
+        capture->_press_edge = capture->_last_edge;
+    }
+    if (events & BUTTON_MASK_RELEASE) {
+        capture->_duration = capture->_last_edge - capture->_press_edge;
+    }
+    return events;
+}
+
+
+/**
+ * @brief Configures a capture channel and starts recording the edges of a button.
+ *
+ * The debounce delay of the button is converted to timer counts, and the
+ * button stops sampling its pin itself.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @param htim Initialized timer, with the channel DMA linked.
+ * @param channel Capture channel of the button pin (TIM_CHANNEL_x).
+ * @param filter Input filter (ICxF), 0 to 15.
+ * @param button Button on the capture pin.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Capture_Start(ButtonCapture* capture, TIM_HandleTypeDef* htim, uint32_t channel,
+                                       uint8_t filter, Button* button) {
+    TIM_IC_InitTypeDef config = {0};
+    HAL_StatusTypeDef status;
+
+    capture->htim = htim;
+    capture->channel = channel;
+    capture->button = button;
+    capture->_guard = (uint32_t)button->_delay * (BUTTON_CAPTURE_TIMER_HZ / 1000);
+    capture->_read = 0;
+    capture->_last_edge = __HAL_TIM_GET_COUNTER(htim);
+    capture->_press_edge = capture->_last_edge;
+    capture->_duration = 0;
+
+    button->_source = BUTTON_SOURCE_CAPTURE;
+    button->_delay = 0;
+    button->_state = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+    capture->_raw = button->_state;
+
+    config.ICPolarity = TIM_ICPOLARITY_BOTHEDGE;
+    config.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    config.ICPrescaler = TIM_ICPSC_DIV1;
+    config.ICFilter = filter;
+    status = HAL_TIM_IC_ConfigChannel(htim, &config, channel);
+    if (status != HAL_OK) {
+        return status;
+    }
+    return HAL_TIM_IC_Start_DMA(htim, channel, capture->_buffer, BUTTON_CAPTURE_EDGES);
+}
+
+
+/**
+ * @brief Debounces the edges captured since the last call and updates the button.
+ *
+ * A level is committed when the next edge came at least the debounce delay
+ * later, or when no edge came for that long.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @return Mask of the BUTTON_MASK_* events produced.
+ */
+uint8_t Button_Capture_Process(ButtonCapture* capture) {
+    Button* button = capture->button;
+    DMA_HandleTypeDef* hdma = capture->htim->hdma[TIM_DMA_ID_CC1 + (capture->channel >> 2)];
+    uint32_t write = (BUTTON_CAPTURE_EDGES - __HAL_DMA_GET_COUNTER(hdma)) % BUTTON_CAPTURE_EDGES;
+    uint8_t events = 0;
+
+    while (capture->_read != write) {
+        uint32_t edge = capture->_buffer[capture->_read];
+        capture->_read = (capture->_read + 1) % BUTTON_CAPTURE_EDGES;
+
+        if (capture->_raw != button->_state && edge - capture->_last_edge >= capture->_guard) {
+            // The previous level held long enough before this edge
+            events |= Button_Capture_Commit(capture);
+        }
+        capture->_raw = (capture->_raw == GPIO_PIN_SET) ? GPIO_PIN_RESET : GPIO_PIN_SET;
+        capture->_last_edge = edge;
+    }
+
+    uint32_t now = __HAL_TIM_GET_COUNTER(capture->htim);
+    if (now - capture->_last_edge >= capture->_guard) {
+        GPIO_PinState level = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+        if (level != capture->_raw) {
+            // Edges were lost, resynchronize on the quiet pin
+            capture->_raw = level;
+            capture->_last_edge = now;
+        } else if (capture->_raw != button->_state) {
+            events |= Button_Capture_Commit(capture);
+        }
+    }
+    return events;
+}
+
+
+/**
+ * @brief Returns the length of the last complete press.
+ *
+ * @param capture Pointer to the ButtonCapture structure.
+ * @return Press duration in timer counts (microseconds at 1 MHz).
+ */
+uint32_t Button_Capture_Duration(ButtonCapture* capture) {
+    return capture->_duration;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file button_chord.c
+ *
+ * @brief Detection of button combinations (chords) from a pressed bitmask.
+ *
+ * @details Pending presses are resolved as soon as no chord containing all
+ * of them is still incomplete, or when the skew window closes: the largest
+ * fully pressed chord is reported and the remaining pins become individual
+ * presses. A pending pin released early is an individual press.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_chord.h"
+
+
+/**
+ * @brief Posts one event per pin of a mask.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @param type One of ButtonEventType.
+ * @param pins Mask of the pins.
+ * @param now Time of the events.
+ */
+static void Button_Chord_Post_Pins(ButtonChord* chord, uint8_t type, uint32_t pins, ButtonTime now) {
+    if (chord->queue == NULL) {
+        return;
+    }
+    for (; pins != 0; pins &= pins - 1) {
+        ButtonEvent event = { now, chord, type, (int8_t)__CLZ(__RBIT(pins)) };
+        Button_Queue_Push(chord->queue, &event);
+    }
+}
+
+
+/**
+ * @brief Initializes a chord detector.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @param chords Pin mask of each chord, kept by reference.
+ * @param count Number of chords.
+ * @param skew_ms Longest time between the first and last press of a chord, in milliseconds.
+ * @param queue Queue receiving the events, or NULL.
+ */
+void Button_Chord_Init(ButtonChord* chord, const uint32_t* chords, uint32_t count, uint16_t skew_ms,
+                       ButtonQueue* queue) {
+    chord->chords = chords;
+    chord->count = count;
+    chord->queue = queue;
+    chord->skew = skew_ms;
+    chord->_pins = 0;
+    chord->_state = 0;
+    chord->_pending = 0;
+    chord->_consumed = 0;
+    chord->_pressed = 0;
+    chord->_start = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        chord->_pins |= chords[i];
+    }
+}
+
+
+/**
+ * @brief Feeds the current pressed state to the detector.
+ *
+ * Call it whenever the state may have changed, and at least every few
+ * milliseconds while presses are pending, so the window closes on time.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @param state Debounced pressed pins.
+ * @param now Current time (Button_Time_Now).
+ * @return Index of the chord recognized by this call, -1 if none.
+ */
+int32_t Button_Chord_Process(ButtonChord* chord, uint32_t state, ButtonTime now) {
+    uint32_t pressed = state & ~chord->_state;
+    uint32_t released = chord->_state & ~state;
+    int32_t best = -1;
+
+    chord->_state = state;
+    chord->_pressed = pressed & ~chord->_pins;
+    Button_Chord_Post_Pins(chord, BUTTON_EVENT_PRESS, chord->_pressed, now);
+
+    pressed &= chord->_pins;
+    if (pressed != 0) {
+        if (chord->_pending == 0) {
+            chord->_start = now;
+        }
+        chord->_pending |= pressed;
+    }
+
+    // A pending pin released before any chord formed was an individual press
+    uint32_t early = released & chord->_pending;
+    chord->_pending &= ~early;
+    chord->_pressed |= early;
+    Button_Chord_Post_Pins(chord, BUTTON_EVENT_PRESS, early, now);
+    Button_Chord_Post_Pins(chord, BUTTON_EVENT_RELEASE, released & ~chord->_consumed, now);
+    chord->_consumed &= ~released;
+
+    if (chord->_pending == 0) {
+        return -1;
+    }
+
+    uint32_t pending = chord->_pending;
+    uint32_t best_size = 0;
+    uint8_t open = 0;
+    for (uint32_t i = 0; i < chord->count; i++) {
+        uint32_t pins = chord->chords[i];
+        if ((pins & pending) == pins) {
+            uint32_t size = __builtin_popcount(pins);
+            if (size > best_size) {
+                best_size = size;
+                best = i;
+            }
+        } else if ((pins & pending) == pending) {
+            // A larger chord may still complete
+            open = 1;
+        }
+    }
+
+    if (open && now - chord->_start < BUTTON_MS_TO_TICKS(chord->skew)) {
+        return -1;
+    }
+
+    if (best >= 0) {
+        uint32_t pins = chord->chords[best];
+        chord->_consumed |= pins;
+        pending &= ~pins;
+        if (chord->queue != NULL) {
+            ButtonEvent event = { now, chord, BUTTON_EVENT_CHORD, (int8_t)best };
+            Button_Queue_Push(chord->queue, &event);
+        }
+    }
+    chord->_pending = 0;
+    chord->_pressed |= pending;
+    Button_Chord_Post_Pins(chord, BUTTON_EVENT_PRESS, pending, now);
+    return best;
+}
+
+
+/**
+ * @brief Returns the individual presses reported by the last Button_Chord_Process.
+ *
+ * @param chord Pointer to the ButtonChord structure.
+ * @return Mask of the pins.
+ */
+uint32_t Button_Chord_Pressed(ButtonChord* chord) {
+    return chord->_pressed;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file button_defer.c
+ *
+ * @brief Two-stage EXTI button handling: record in the EXTI ISR, process in PendSV.
+ *
+ * @details The top halves of different EXTI vectors may preempt each other,
+ * so a record is reserved and written with interrupts disabled for a few
+ * instructions. PendSV is the only reader.
+ *
+ * Edges inside the debounce delay of a button are ignored by Button_Update,
+ * so the last one may leave the pin at another level than the accepted one
+ * (release bounce, glitch). Lines with edges are therefore sampled again
+ * when their delay ends, from a bottom half run by the timer wheel.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_defer.h"
+
+
+/**
+ * @brief Records one edge, or marks the line as lost if the ring is full.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param line EXTI line.
+ * @param timestamp Low 32 bits of the edge time.
+ */
+static BUTTON_CCM_CODE void Button_Defer_Record(ButtonDefer* defer, uint32_t line, uint32_t timestamp) {
+    Button* button = defer->_buttons[line];
+    uint32_t bit = 1U << line;
+
+    if (button == NULL) {
+        return;
+    }
+    uint8_t level = (button->GPIO_Port->IDR & bit) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t head = defer->_head;
+    if (head - defer->_tail < BUTTON_DEFER_SIZE) {
+        ButtonDeferRecord* record = &defer->_records[head & (BUTTON_DEFER_SIZE - 1)];
+        record->timestamp = timestamp;
+        record->line = line;
+        record->level = level;
+        defer->_head = head + 1;
+    } else {
+        defer->_lost |= bit;
+    }
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Timer expiry: a debounce delay ended, run the bottom half.
+ *
+ * @param owner The ButtonDefer structure.
+ */
+static void Button_Defer_Timeout(void* owner) {
+    (void)owner;
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+
+/**
+ * @brief Samples the lines whose debounce delay ended and corrects their state.
+ *
+ * Lines still in their delay stay in the set, and the timer is started for
+ * the latest of those delays.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param now Current time.
+ */
+static void Button_Defer_Verify(ButtonDefer* defer, ButtonTime now) {
+    ButtonTime wait = 0;
+
+    for (uint32_t pending = defer->_verify; pending != 0; pending &= pending - 1) {
+        uint32_t line = __CLZ(__RBIT(pending));
+        Button* button = defer->_buttons[line];
+
+        if (now >= button->_ignore_until) {
+            GPIO_PinState level = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+            if (level == button->_state) {
+                defer->_verify &= ~(1U << line);
+                continue;
+            }
+            // The pin settled on the other level, a new delay starts
+            Button_Update(button, level, now);
+        }
+        if (button->_ignore_until - now > wait) {
+            wait = button->_ignore_until - now;
+        }
+    }
+
+    if (defer->_verify != 0) {
+        Button_Timer_Start(&defer->_timer, (uint32_t)(wait * 1000 / BUTTON_TIME_HZ) + 1);
+    }
+}
+
+
+/**
+ * @brief Initializes a deferred handler.
+ *
+ * PendSV gets the lowest priority, so the bottom half never delays another
+ * interrupt.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ */
+void Button_Defer_Init(ButtonDefer* defer) {
+    defer->_head = 0;
+    defer->_tail = 0;
+    defer->_lost = 0;
+    defer->_verify = 0;
+    Button_Timer_Init(&defer->_timer, Button_Defer_Timeout, defer);
+    for (uint32_t i = 0; i < BUTTON_EXTI_LINES; i++) {
+        defer->_buttons[i] = NULL;
+    }
+    NVIC_SetPriority(PendSV_IRQn, (1U << __NVIC_PRIO_BITS) - 1);
+}
+
+
+/**
+ * @brief Hands the edges of a button to the deferred handler.
+ *
+ * The button keeps its own debounce delay, but is no longer sampled by
+ * Button_IRQ_Handler or Button_Poll.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param button Button whose pin is configured as EXTI input.
+ */
+void Button_Defer_Attach(ButtonDefer* defer, Button* button) {
+    button->_source = BUTTON_SOURCE_DEFER;
+    defer->_buttons[__CLZ(__RBIT(button->_pin))] = button;
+}
+
+
+/**
+ * @brief Top half for one line.
+ *
+ * The pending bit was already cleared by HAL_GPIO_EXTI_IRQHandler.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param GPIO_Pin Pin of the interrupting line.
+ */
+BUTTON_CCM_CODE void Button_Defer_Edge(ButtonDefer* defer, uint16_t GPIO_Pin) {
+    Button_Defer_Record(defer, __CLZ(__RBIT(GPIO_Pin)), (uint32_t)Button_Time_Now());
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+
+/**
+ * @brief Top half for all pending lines of an EXTI vector.
+ *
+ * Reads EXTI->PR once and gives all the lines the same timestamp.
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ * @param lines Lines of the vector (BUTTON_EXTI_LINE(n), BUTTON_EXTI_LINES_9_5...).
+ */
+BUTTON_CCM_CODE void Button_Defer_IRQHandler(ButtonDefer* defer, uint32_t lines) {
+    uint32_t pending = EXTI->PR & lines;
+
+    if (pending == 0) {
+        return;
+    }
+    EXTI->PR = pending;
+
+    uint32_t timestamp = (uint32_t)Button_Time_Now();
+    for (; pending != 0; pending &= pending - 1) {
+        Button_Defer_Record(defer, __CLZ(__RBIT(pending)), timestamp);
+    }
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+
+/**
+ * @brief Bottom half: runs the button state machines on the recorded edges.
+ *
+ * Records are processed oldest first with their own timestamps, extended
+ * back to 64 bits from the current time. Lines that lost records are then
+ * sampled from their pins, and lines with edges are sampled again at the end
+ * of their debounce delay (needs Button_Timer_Tick).
+ *
+ * @param defer Pointer to the ButtonDefer structure.
+ */
+void Button_Defer_Process(ButtonDefer* defer) {
+    ButtonTime now = Button_Time_Now();
+    uint32_t head = defer->_head;
+    uint32_t tail = defer->_tail;
+
+    while (tail != head) {
+        ButtonDeferRecord* record = &defer->_records[tail & (BUTTON_DEFER_SIZE - 1)];
+        ButtonTime time = now - (uint32_t)((uint32_t)now - record->timestamp);
+        Button_Update(defer->_buttons[record->line], (GPIO_PinState)record->level, time);
+        defer->_verify |= 1U << record->line;
+        tail++;
+    }
+    defer->_tail = tail;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t lost = defer->_lost;
+    defer->_lost = 0;
+    __set_PRIMASK(primask);
+
+    for (defer->_verify |= lost; lost != 0; lost &= lost - 1) {
+        Button* button = defer->_buttons[__CLZ(__RBIT(lost))];
+        Button_Update(button, HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin), now);
+    }
+
+    Button_Defer_Verify(defer, now);
+}
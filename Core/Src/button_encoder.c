@@ -0,0 +1,147 @@
+/**
+ * @file button_encoder.c
+ *
+ * @brief Quadrature rotary encoders on a timer in encoder mode.
+ *
+ * @details The counter delta is taken as a 16-bit signed difference, so
+ * the counter may wrap, and 16 and 32-bit timers behave the same as long as
+ * the knob turns less than 32767 counts between two samples. The speed is
+ * the number of detents completed by a sample divided by the time since the
+ * previous sample that completed detents, in detents/s. It does not depend
+ * on how often the counter is sampled: an isolated detent after a pause is
+ * slow. While the knob stands still, the speed is capped by one detent over
+ * the time since the last one, so it decays to zero.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_encoder.h"
+
+
+/**
+ * @brief Starts counting.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @param htim Timer initialized in encoder mode.
+ * @param steps Counts per detent.
+ * @param queue Queue receiving the ROTATE events, or NULL.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Encoder_Start(ButtonEncoder* encoder, TIM_HandleTypeDef* htim, uint8_t steps,
+                                       ButtonQueue* queue) {
+    encoder->htim = htim;
+    encoder->queue = queue;
+    encoder->steps = (steps != 0) ? steps : 1;
+    encoder->threshold = 0;
+    encoder->gain = 0;
+    encoder->_last = __HAL_TIM_GET_COUNTER(htim);
+    encoder->_residue = 0;
+    encoder->_position = 0;
+    encoder->_velocity = 0;
+    encoder->_time = Button_Time_Now();
+
+    return HAL_TIM_Encoder_Start(htim, TIM_CHANNEL_ALL);
+}
+
+
+/**
+ * @brief Stops counting.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Encoder_Stop(ButtonEncoder* encoder) {
+    return HAL_TIM_Encoder_Stop(encoder->htim, TIM_CHANNEL_ALL);
+}
+
+
+/**
+ * @brief Sets the acceleration of an encoder.
+ *
+ * At speed v above the threshold, each detent counts for
+ * 1 + (v - threshold) * gain / 256 detents.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @param threshold Speed in detents/s above which rotation accelerates, 0 to disable.
+ * @param gain Extra detents per detent, /256, per detent/s above the threshold.
+ */
+void Button_Encoder_Set_Accel(ButtonEncoder* encoder, uint16_t threshold, uint16_t gain) {
+    encoder->threshold = threshold;
+    encoder->gain = gain;
+}
+
+
+/**
+ * @brief Samples the counter and reports the rotation.
+ *
+ * Large rotations are split into several events, as the event value is
+ * limited to +/-127 detents.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return Detents turned since the last call after acceleration, positive when counting up.
+ */
+int32_t Button_Encoder_Process(ButtonEncoder* encoder) {
+    uint16_t count = __HAL_TIM_GET_COUNTER(encoder->htim);
+    ButtonTime now = Button_Time_Now();
+    ButtonTime elapsed = now - encoder->_time;
+
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+
+    encoder->_residue += (int16_t)(count - encoder->_last);
+    encoder->_last = count;
+
+    int32_t detents = encoder->_residue / encoder->steps;
+    encoder->_residue -= detents * encoder->steps;
+
+    if (detents == 0) {
+        uint32_t bound = (uint32_t)(BUTTON_TIME_HZ / elapsed);
+        if (encoder->_velocity > bound) {
+            encoder->_velocity = bound;
+        }
+        return 0;
+    }
+
+    uint32_t magnitude = (detents < 0) ? -detents : detents;
+    encoder->_velocity = (uint32_t)((ButtonTime)magnitude * BUTTON_TIME_HZ / elapsed);
+    encoder->_time = now;
+
+    if (encoder->threshold != 0 && encoder->_velocity > encoder->threshold) {
+        detents = detents * (int32_t)(256 + (encoder->_velocity - encoder->threshold) * encoder->gain) / 256;
+    }
+    encoder->_position += detents;
+
+    if (encoder->queue != NULL) {
+        for (int32_t left = detents; left != 0;) {
+            int32_t part = (left > 127) ? 127 : (left < -127) ? -127 : left;
+            ButtonEvent event = { now, encoder, BUTTON_EVENT_ROTATE, (int8_t)part };
+            Button_Queue_Push(encoder->queue, &event);
+            left -= part;
+        }
+    }
+    return detents;
+}
+
+
+/**
+ * @brief Returns the sum of the reported detents.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return Position in accelerated detents.
+ */
+int32_t Button_Encoder_Position(ButtonEncoder* encoder) {
+    return encoder->_position;
+}
+
+
+/**
+ * @brief Returns the speed of rotation.
+ *
+ * @param encoder Pointer to the ButtonEncoder structure.
+ * @return Smoothed speed in detents/s.
+ */
+uint32_t Button_Encoder_Velocity(ButtonEncoder* encoder) {
+    return encoder->_velocity;
+}
@@ -0,0 +1,250 @@
+/**
+ * @file button_expander.c
+ *
+ * @brief Buttons on I2C GPIO expanders (MCP23017, MCP23008, PCF8574...).
+ *
+ * @details Reads are queued with per-expander flags and started by whoever
+ * finds the bus idle (EXTI, I2C completion or tick), claiming it in a short
+ * critical section. An expander stays unsettled while its raw inputs differ
+ * from the debounced state, and is read again at each tick until they match.
+ * When the queue empties, INT lines still low are queued again, as their
+ * falling edge may have come while the expander was being read.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_expander.h"
+
+
+/**
+ * @brief Starts the next queued read if the bus is idle.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ */
+static void Button_Expander_Kick(ButtonExpanderBus* bus) {
+    ButtonExpander* expander = NULL;
+    HAL_StatusTypeDef status;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (bus->_current == NULL) {
+        for (expander = bus->_expanders; expander != NULL; expander = expander->_next) {
+            if (expander->_pending) {
+                expander->_pending = 0;
+                bus->_current = expander;
+                break;
+            }
+        }
+    }
+    __set_PRIMASK(primask);
+
+    if (expander == NULL) {
+        return;
+    }
+
+    if (expander->reg == BUTTON_EXPANDER_NO_REG) {
+        status = HAL_I2C_Master_Receive_DMA(bus->hi2c, expander->address, expander->_data, expander->size);
+    } else {
+        status = HAL_I2C_Mem_Read_DMA(bus->hi2c, expander->address, expander->reg, I2C_MEMADD_SIZE_8BIT,
+                                      expander->_data, expander->size);
+    }
+    if (status != HAL_OK) {
+        // Bus busy or faulty, leave it to the next tick
+        bus->_errors++;
+        expander->_unsettled = 1;
+        bus->_current = NULL;
+    }
+}
+
+
+/**
+ * @brief Queues the expanders whose INT line is asserted.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ */
+static void Button_Expander_Check_Int(ButtonExpanderBus* bus) {
+    for (ButtonExpander* expander = bus->_expanders; expander != NULL; expander = expander->_next) {
+        if (HAL_GPIO_ReadPin(expander->int_port, expander->int_pin) == GPIO_PIN_RESET) {
+            expander->_pending = 1;
+        }
+    }
+}
+
+
+/**
+ * @brief Initializes an expander bus.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param hi2c Initialized I2C handle.
+ */
+void Button_Expander_Bus_Init(ButtonExpanderBus* bus, I2C_HandleTypeDef* hi2c) {
+    bus->hi2c = hi2c;
+    bus->_expanders = NULL;
+    bus->_current = NULL;
+    bus->_errors = 0;
+}
+
+
+/**
+ * @brief Adds an expander to a bus and queues its first read.
+ *
+ * The read is started by the next tick.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param expander Pointer to the ButtonExpander structure.
+ * @param address I2C address, shifted left.
+ * @param reg Input register, BUTTON_EXPANDER_NO_REG if none.
+ * @param size Bytes read, 1 or 2.
+ * @param int_port GPIO port of the INT line.
+ * @param int_pin EXTI pin of the INT line.
+ * @param active_low Mask of the inputs that read 0 when pressed.
+ */
+void Button_Expander_Init(ButtonExpanderBus* bus, ButtonExpander* expander, uint16_t address, uint16_t reg,
+                          uint8_t size, GPIO_TypeDef* int_port, uint16_t int_pin, uint16_t active_low) {
+    expander->address = address;
+    expander->reg = reg;
+    expander->size = (size > 1) ? 2 : 1;
+    expander->int_port = int_port;
+    expander->int_pin = int_pin;
+    expander->_pending = 0;
+    expander->_unsettled = 1;
+    expander->_data[0] = 0;
+    expander->_data[1] = 0;
+    Button_Port_Init(&expander->_port, NULL, active_low);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    expander->_next = bus->_expanders;
+    bus->_expanders = expander;
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Lets an expander drive a button.
+ *
+ * @param expander Pointer to the ButtonExpander structure.
+ * @param button Initialized button.
+ * @param input Expander input, 0 to 15.
+ * @return HAL_OK, or HAL_ERROR if the input does not exist.
+ */
+HAL_StatusTypeDef Button_Expander_Attach(ButtonExpander* expander, Button* button, uint8_t input) {
+    if (input >= 8U * expander->size) {
+        return HAL_ERROR;
+    }
+
+    button->GPIO_Port = NULL;
+    button->_pin = 1U << input;
+    Button_Port_Attach(&expander->_port, button);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Queues a read of the expanders on an INT line.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param GPIO_Pin Interrupting pin; pins of no expander are ignored.
+ */
+void Button_Expander_Edge(ButtonExpanderBus* bus, uint16_t GPIO_Pin) {
+    uint8_t queued = 0;
+
+    for (ButtonExpander* expander = bus->_expanders; expander != NULL; expander = expander->_next) {
+        if (expander->int_pin == GPIO_Pin) {
+            expander->_pending = 1;
+            queued = 1;
+        }
+    }
+    if (queued) {
+        Button_Expander_Kick(bus);
+    }
+}
+
+
+/**
+ * @brief Debounces a finished read and starts the next one.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param hi2c Handle of the callback; other buses are ignored.
+ */
+void Button_Expander_Complete(ButtonExpanderBus* bus, I2C_HandleTypeDef* hi2c) {
+    ButtonExpander* expander = bus->_current;
+
+    if (hi2c != bus->hi2c || expander == NULL) {
+        return;
+    }
+
+    uint32_t sample = expander->_data[0] | ((uint32_t)expander->_data[1] << 8);
+    Button_Port_Debounce(&expander->_port, sample, Button_Time_Now());
+    expander->_unsettled = ((sample ^ expander->_port._active_low) & 0xFFFF) != Button_Port_State(&expander->_port);
+
+    bus->_current = NULL;
+    Button_Expander_Kick(bus);
+    if (bus->_current == NULL) {
+        Button_Expander_Check_Int(bus);
+        Button_Expander_Kick(bus);
+    }
+}
+
+
+/**
+ * @brief Drops a failed read, retried at the next tick.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @param hi2c Handle of the callback; other buses are ignored.
+ */
+void Button_Expander_Error(ButtonExpanderBus* bus, I2C_HandleTypeDef* hi2c) {
+    ButtonExpander* expander = bus->_current;
+
+    if (hi2c != bus->hi2c || expander == NULL) {
+        return;
+    }
+    bus->_errors++;
+    expander->_unsettled = 1;
+    bus->_current = NULL;
+    Button_Expander_Kick(bus);
+}
+
+
+/**
+ * @brief Reads again the expanders still bouncing or in error.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ */
+void Button_Expander_Tick(ButtonExpanderBus* bus) {
+    uint8_t queued = 0;
+
+    for (ButtonExpander* expander = bus->_expanders; expander != NULL; expander = expander->_next) {
+        if (expander->_unsettled) {
+            expander->_unsettled = 0;
+            expander->_pending = 1;
+            queued = 1;
+        }
+    }
+    if (queued) {
+        Button_Expander_Kick(bus);
+    }
+}
+
+
+/**
+ * @brief Returns the debounced state of an expander.
+ *
+ * @param expander Pointer to the ButtonExpander structure.
+ * @return Mask of the pressed inputs.
+ */
+uint32_t Button_Expander_State(ButtonExpander* expander) {
+    return Button_Port_State(&expander->_port);
+}
+
+
+/**
+ * @brief Returns the number of failed transfers on a bus.
+ *
+ * @param bus Pointer to the ButtonExpanderBus structure.
+ * @return Error count since initialization.
+ */
+uint32_t Button_Expander_Errors(ButtonExpanderBus* bus) {
+    return bus->_errors;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file button_exti.c
+ *
+ * @brief EXTI dispatch and hardware-assisted debouncing of EXTI buttons.
+ *
+ * @details All masked lines share one compare channel: it is always
+ * programmed with the earliest pending deadline, and each compare interrupt
+ * re-arms every line whose deadline has passed. Deadlines are 16-bit timer
+ * counts compared with wrap-safe differences.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_exti.h"
+
+
+/**
+ * @brief Selects the trigger edge of a line from the button state.
+ *
+ * Falling edge while released, rising edge while pressed. Must be called with
+ * interrupts disabled, as EXTI registers are shared by all lines.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param bit Mask of the line.
+ * @param state Current (debounced) state of the button.
+ */
+static BUTTON_CCM_CODE void Button_Exti_Set_Edge(ButtonExti* exti, uint32_t bit, GPIO_PinState state) {
+    if (!exti->_switch_edge) {
+        return;
+    }
+    if (state == GPIO_PIN_SET) {
+        EXTI->RTSR &= ~bit;
+        EXTI->FTSR |= bit;
+    } else {
+        EXTI->FTSR &= ~bit;
+        EXTI->RTSR |= bit;
+    }
+}
+
+
+/**
+ * @brief Programs the compare channel with the earliest pending deadline.
+ *
+ * Must be called with interrupts disabled.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ */
+static BUTTON_CCM_CODE void Button_Exti_Schedule(ButtonExti* exti) {
+    TIM_HandleTypeDef* htim = exti->htim;
+    uint32_t it = TIM_IT_CC1 << (exti->channel >> 2);
+
+    if (exti->_masked == 0) {
+        __HAL_TIM_DISABLE_IT(htim, it);
+        return;
+    }
+
+    uint16_t now = __HAL_TIM_GET_COUNTER(htim);
+    int32_t earliest = INT16_MAX;
+    for (uint32_t pending = exti->_masked; pending != 0; pending &= pending - 1) {
+        uint32_t line = __CLZ(__RBIT(pending));
+        int32_t remaining = (int16_t)(exti->_deadline[line] - now);
+        if (remaining < earliest) {
+            earliest = remaining;
+        }
+    }
+    if (earliest < 1) {
+        earliest = 1;
+    }
+
+    __HAL_TIM_CLEAR_FLAG(htim, it);
+    __HAL_TIM_SET_COMPARE(htim, exti->channel, (uint16_t)(now + earliest));
+    if ((int16_t)(__HAL_TIM_GET_COMPARE(htim, exti->channel) - __HAL_TIM_GET_COUNTER(htim)) <= 0) {
+        // The counter already passed the compare value, raise the event now
+        htim->Instance->EGR = TIM_EGR_CC1G << (exti->channel >> 2);
+    }
+    __HAL_TIM_ENABLE_IT(htim, it);
+}
+
+
+/**
+ * @brief Initializes the EXTI table and starts the re-arm timer, if any.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param htim Initialized free-running timer, period 0xFFFF, or NULL to only dispatch edges.
+ * @param channel Compare channel used for re-arming (TIM_CHANNEL_x).
+ * @param switch_edge 1 to trigger on one edge only, following the button state.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Exti_Init(ButtonExti* exti, TIM_HandleTypeDef* htim, uint32_t channel,
+                                   uint8_t switch_edge) {
+    exti->htim = htim;
+    exti->channel = channel;
+    exti->_switch_edge = switch_edge;
+    exti->_masked = 0;
+    for (uint32_t i = 0; i < BUTTON_EXTI_LINES; i++) {
+        exti->_deadline[i] = 0;
+        exti->_guard[i] = 0;
+        exti->_buttons[i] = NULL;
+    }
+
+    if (htim == NULL) {
+        return HAL_OK;
+    }
+    __HAL_TIM_DISABLE_IT(htim, TIM_IT_CC1 << (channel >> 2));
+    if (htim->State == HAL_TIM_STATE_READY) {
+        return HAL_TIM_Base_Start(htim);
+    }
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Registers a button on its EXTI line.
+ *
+ * Without a re-arm timer the button keeps its own time lockout. With one, the
+ * debounce delay of the button is converted to timer counts and the button
+ * is debounced by masking its line instead.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param button Button whose pin is configured as EXTI input.
+ */
+void Button_Exti_Attach(ButtonExti* exti, Button* button) {
+    uint32_t line = __CLZ(__RBIT(button->_pin));
+    uint32_t guard = (uint32_t)button->_delay * BUTTON_EXTI_TIMER_HZ / 1000;
+
+    exti->_buttons[line] = button;
+    if (exti->htim == NULL) {
+        return;
+    }
+
+    if (guard > INT16_MAX) {
+        guard = INT16_MAX;
+    }
+
+    button->_source = BUTTON_SOURCE_EXTI;
+    button->_delay = 0;
+    button->_state = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+    exti->_guard[line] = guard;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Button_Exti_Set_Edge(exti, button->_pin, button->_state);
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Handles an edge on one line.
+ *
+ * Without a re-arm timer the button handles the edge itself. Otherwise the
+ * edge is accepted, the line is masked and its re-arming scheduled. With edge
+ * switching the new state follows from the edge direction, otherwise the pin
+ * is read.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param line Interrupting EXTI line.
+ */
+static BUTTON_CCM_CODE void Button_Exti_Service(ButtonExti* exti, uint32_t line) {
+    Button* button = exti->_buttons[line];
+    uint32_t bit = 1U << line;
+    GPIO_PinState level;
+
+    if (button == NULL) {
+        return;
+    }
+    if (exti->htim == NULL) {
+        Button_IRQ_Handler(button);
+        return;
+    }
+
+    if (exti->_switch_edge) {
+        level = (button->_state == GPIO_PIN_SET) ? GPIO_PIN_RESET : GPIO_PIN_SET;
+    } else {
+        level = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    EXTI->IMR &= ~bit;
+    exti->_masked |= bit;
+    exti->_deadline[line] = __HAL_TIM_GET_COUNTER(exti->htim) + exti->_guard[line];
+    Button_Exti_Schedule(exti);
+    __set_PRIMASK(primask);
+
+    Button_Update(button, level, Button_Time_Now());
+}
+
+
+/**
+ * @brief Handles an edge on a button line.
+ *
+ * Call from HAL_GPIO_EXTI_Callback; the button is found in the line table.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param GPIO_Pin Pin of the interrupting line.
+ */
+BUTTON_CCM_CODE void Button_Exti_Edge(ButtonExti* exti, uint16_t GPIO_Pin) {
+    Button_Exti_Service(exti, __CLZ(__RBIT(GPIO_Pin)));
+}
+
+
+/**
+ * @brief Services all pending lines of an EXTI vector.
+ *
+ * Reads EXTI->PR once per pass, acknowledges all the pending lines with a
+ * single write and services them in line order, so simultaneous edges on a
+ * shared vector are handled in one ISR entry. Lines without a button are
+ * acknowledged too.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param lines Lines of the vector (BUTTON_EXTI_LINE(n), BUTTON_EXTI_LINES_9_5...).
+ */
+BUTTON_CCM_CODE void Button_Exti_IRQHandler(ButtonExti* exti, uint32_t lines) {
+    uint32_t pending;
+
+    while ((pending = EXTI->PR & lines) != 0) {
+        EXTI->PR = pending;
+        for (; pending != 0; pending &= pending - 1) {
+            Button_Exti_Service(exti, __CLZ(__RBIT(pending)));
+        }
+    }
+}
+
+
+/**
+ * @brief Re-arms one line after its debounce delay.
+ *
+ * If the pin changed while the line was masked (e.g. a short tap), the change
+ * is reported and the line stays masked for another delay.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ * @param line EXTI line to re-arm.
+ * @param now Current timer count.
+ */
+static void Button_Exti_Rearm(ButtonExti* exti, uint32_t line, uint16_t now) {
+    Button* button = exti->_buttons[line];
+    uint32_t bit = 1U << line;
+    GPIO_PinState level = HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin);
+
+    if (level != button->_state) {
+        exti->_deadline[line] = now + exti->_guard[line];
+        Button_Update(button, level, Button_Time_Now());
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    exti->_masked &= ~bit;
+    EXTI->PR = bit;  // Drop the edges seen while masked
+    Button_Exti_Set_Edge(exti, bit, level);
+    EXTI->IMR |= bit;
+    __set_PRIMASK(primask);
+
+    // An edge between the read and the unmask would be lost, replay it
+    if (HAL_GPIO_ReadPin(button->GPIO_Port, button->_pin) != button->_state) {
+        EXTI->SWIER = bit;
+    }
+}
+
+
+/**
+ * @brief Re-arms the lines whose debounce delay expired.
+ *
+ * Call from the IRQ handler of the timer.
+ *
+ * @param exti Pointer to the ButtonExti structure.
+ */
+void Button_Exti_Timer_IRQHandler(ButtonExti* exti) {
+    uint32_t flag = TIM_FLAG_CC1 << (exti->channel >> 2);
+
+    if (__HAL_TIM_GET_FLAG(exti->htim, flag) == RESET) {
+        return;
+    }
+    __HAL_TIM_CLEAR_FLAG(exti->htim, flag);
+
+    uint16_t now = __HAL_TIM_GET_COUNTER(exti->htim);
+    for (uint32_t pending = exti->_masked; pending != 0; pending &= pending - 1) {
+        uint32_t line = __CLZ(__RBIT(pending));
+        if ((int16_t)(exti->_deadline[line] - now) <= 0) {
+            Button_Exti_Rearm(exti, line, now);
+        }
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Button_Exti_Schedule(exti);
+    __set_PRIMASK(primask);
+}
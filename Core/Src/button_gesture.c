@@ -0,0 +1,185 @@
+/**
+ * @file button_gesture.c
+ *
+ * @brief Recognition of event sequences (gestures) with a finite automaton.
+ *
+ * @details State 0 is the empty prefix. The patterns are first inserted in a
+ * trie, then the states are visited breadth first: a missing transition is
+ * replaced by the transition of the failure state (longest proper suffix
+ * that is also a prefix), and a state that ends no pattern inherits the
+ * pattern of its failure state. The result is a complete transition table.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_gesture.h"
+
+
+#define BUTTON_GESTURE_NONE			0xFF	/* Missing trie transition */
+
+
+/**
+ * @brief Builds the automaton of a set of patterns.
+ *
+ * @param gesture Pointer to the ButtonGesture structure.
+ * @param alphabet Symbol table, kept by reference.
+ * @param symbol_count Symbols in the alphabet, at most BUTTON_GESTURE_SYMBOLS.
+ * @param patterns Pattern table, kept by reference.
+ * @param pattern_count Patterns in the table.
+ * @param gap_ms Longest time between two events of a gesture, in milliseconds.
+ * @param queue Queue receiving GESTURE events, or NULL.
+ * @return HAL_OK, or HAL_ERROR if the tables exceed the limits.
+ */
+HAL_StatusTypeDef Button_Gesture_Compile(ButtonGesture* gesture, const ButtonGestureSymbol* alphabet,
+                                         uint8_t symbol_count, const ButtonGesturePattern* patterns,
+                                         uint8_t pattern_count, uint16_t gap_ms, ButtonQueue* queue) {
+    uint8_t fail[BUTTON_GESTURE_STATES];
+    uint8_t order[BUTTON_GESTURE_STATES];
+    uint32_t states = 1;
+
+    gesture->alphabet = alphabet;
+    gesture->patterns = patterns;
+    gesture->queue = queue;
+    gesture->symbol_count = symbol_count;
+    gesture->pattern_count = pattern_count;
+    gesture->gap = gap_ms;
+    gesture->_state = 0;
+    gesture->_head = 0;
+    gesture->_valid = 0;
+
+    if (symbol_count > BUTTON_GESTURE_SYMBOLS || pattern_count > INT8_MAX) {
+        return HAL_ERROR;
+    }
+    for (uint32_t s = 0; s < BUTTON_GESTURE_STATES; s++) {
+        for (uint32_t a = 0; a < BUTTON_GESTURE_SYMBOLS; a++) {
+            gesture->_next[s][a] = BUTTON_GESTURE_NONE;
+        }
+        gesture->_accept[s] = -1;
+    }
+
+    // Trie of the patterns
+    for (uint32_t p = 0; p < pattern_count; p++) {
+        uint32_t state = 0;
+
+        if (patterns[p].length == 0 || patterns[p].length > BUTTON_GESTURE_LENGTH) {
+            return HAL_ERROR;
+        }
+        for (uint32_t i = 0; i < patterns[p].length; i++) {
+            uint8_t symbol = patterns[p].symbols[i];
+            if (symbol >= symbol_count) {
+                return HAL_ERROR;
+            }
+            if (gesture->_next[state][symbol] == BUTTON_GESTURE_NONE) {
+                if (states == BUTTON_GESTURE_STATES) {
+                    return HAL_ERROR;
+                }
+                gesture->_next[state][symbol] = states++;
+            }
+            state = gesture->_next[state][symbol];
+        }
+        if (gesture->_accept[state] < 0) {
+            gesture->_accept[state] = p;
+        }
+    }
+
+    // Breadth-first completion with the failure links
+    uint32_t head = 0, tail = 0;
+    for (uint32_t a = 0; a < symbol_count; a++) {
+        uint8_t child = gesture->_next[0][a];
+        if (child == BUTTON_GESTURE_NONE) {
+            gesture->_next[0][a] = 0;
+        } else {
+            fail[child] = 0;
+            order[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        uint8_t state = order[head++];
+        if (gesture->_accept[state] < 0) {
+            gesture->_accept[state] = gesture->_accept[fail[state]];
+        }
+        for (uint32_t a = 0; a < symbol_count; a++) {
+            uint8_t child = gesture->_next[state][a];
+            if (child == BUTTON_GESTURE_NONE) {
+                gesture->_next[state][a] = gesture->_next[fail[state]][a];
+            } else {
+                fail[child] = gesture->_next[fail[state]][a];
+                order[tail++] = child;
+            }
+        }
+    }
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Feeds one event to the recognizer.
+ *
+ * Events outside the alphabet are ignored. A gap longer than gesture->gap
+ * restarts the recognition. A pattern is recognized when its last symbol
+ * arrives within its window from its first one; the recognition then
+ * restarts, so the events of one gesture are not reused by the next.
+ *
+ * @param gesture Pointer to the ButtonGesture structure.
+ * @param event Button event.
+ * @return Index of the pattern recognized by this event, -1 if none.
+ */
+int32_t Button_Gesture_Feed(ButtonGesture* gesture, const ButtonEvent* event) {
+    uint32_t symbol;
+
+    for (symbol = 0; symbol < gesture->symbol_count; symbol++) {
+        const ButtonGestureSymbol* entry = &gesture->alphabet[symbol];
+        if (entry->source == event->source && entry->type == event->type &&
+            (entry->value == BUTTON_GESTURE_ANY || entry->value == event->value)) {
+            break;
+        }
+    }
+    if (symbol == gesture->symbol_count) {
+        return -1;
+    }
+
+    ButtonTime last = gesture->_times[(gesture->_head + BUTTON_GESTURE_LENGTH - 1) % BUTTON_GESTURE_LENGTH];
+    if (gesture->_valid != 0 && event->timestamp - last > BUTTON_MS_TO_TICKS(gesture->gap)) {
+        gesture->_state = 0;
+    }
+    gesture->_times[gesture->_head] = event->timestamp;
+    gesture->_head = (gesture->_head + 1) % BUTTON_GESTURE_LENGTH;
+    if (gesture->_valid < BUTTON_GESTURE_LENGTH) {
+        gesture->_valid++;
+    }
+
+    gesture->_state = gesture->_next[gesture->_state][symbol];
+    int32_t match = gesture->_accept[gesture->_state];
+    if (match < 0) {
+        return -1;
+    }
+
+    const ButtonGesturePattern* pattern = &gesture->patterns[match];
+    if (pattern->length > gesture->_valid) {
+        return -1;
+    }
+    uint32_t start = (gesture->_head + BUTTON_GESTURE_LENGTH - pattern->length) % BUTTON_GESTURE_LENGTH;
+    ButtonTime first = gesture->_times[start];
+    if (event->timestamp - first > BUTTON_MS_TO_TICKS(pattern->window)) {
+        return -1;
+    }
+
+    gesture->_state = 0;
+    if (gesture->queue != NULL) {
+        ButtonEvent found = { event->timestamp, gesture, BUTTON_EVENT_GESTURE, (int8_t)match };
+        Button_Queue_Push(gesture->queue, &found);
+    }
+    return match;
+}
+
+
+/**
+ * @brief ButtonCallback feeding a recognizer.
+ *
+ * @param event Button event.
+ * @param user Pointer to the ButtonGesture structure.
+ */
+void Button_Gesture_Callback(const ButtonEvent* event, void* user) {
+    Button_Gesture_Feed((ButtonGesture*)user, event);
+}
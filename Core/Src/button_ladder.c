@@ -0,0 +1,281 @@
+/**
+ * @file button_ladder.c
+ *
+ * @brief Resistor ladder buttons read by timer-triggered ADC conversions.
+ *
+ * @details Decoding looks for the nearest level (the idle level included)
+ * and only leaves the current one when the reading is more than hysteresis
+ * codes closer to the new one, i.e. hysteresis / 2 past the midpoint.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_ladder.h"
+
+
+/**
+ * @brief Waits for register bits to reach a value.
+ *
+ * @param reg Register to poll.
+ * @param mask Bits to test.
+ * @param value Expected value of the bits.
+ * @return HAL_OK, or HAL_TIMEOUT after BUTTON_LADDER_TIMEOUT_MS.
+ */
+static HAL_StatusTypeDef Button_Ladder_Wait(volatile uint32_t* reg, uint32_t mask, uint32_t value) {
+    uint32_t start = HAL_GetTick();
+
+    while ((*reg & mask) != value) {
+        if (HAL_GetTick() - start > BUTTON_LADDER_TIMEOUT_MS) {
+            return HAL_TIMEOUT;
+        }
+    }
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Returns the code distance between a reading and a level.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @param code Reading.
+ * @param index Button index, or BUTTON_LADDER_NONE for the idle level.
+ * @return Absolute difference.
+ */
+static uint32_t Button_Ladder_Distance(ButtonLadder* ladder, uint32_t code, uint32_t index) {
+    int32_t level = (index == BUTTON_LADDER_NONE) ? ladder->idle : ladder->levels[index];
+    int32_t diff = (int32_t)code - level;
+
+    return (diff < 0) ? -diff : diff;
+}
+
+
+/**
+ * @brief Decodes a reading into a button.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @param code Averaged reading.
+ */
+static void Button_Ladder_Decode(ButtonLadder* ladder, uint32_t code) {
+    uint32_t nearest = BUTTON_LADDER_NONE;
+    uint32_t best = Button_Ladder_Distance(ladder, code, BUTTON_LADDER_NONE);
+
+    for (uint32_t i = 0; i < ladder->count; i++) {
+        uint32_t distance = Button_Ladder_Distance(ladder, code, i);
+        if (distance < best) {
+            best = distance;
+            nearest = i;
+        }
+    }
+
+    ladder->_code = code;
+    if (nearest != ladder->_current &&
+        Button_Ladder_Distance(ladder, code, ladder->_current) > best + ladder->hysteresis) {
+        ladder->_current = nearest;
+    }
+}
+
+
+/**
+ * @brief DMA transfer complete callback: BUTTON_LADDER_AVERAGE sequences are ready.
+ *
+ * @param hdma ADC DMA handle, its Parent is the ButtonLadderAdc.
+ */
+static void Button_Ladder_Complete(DMA_HandleTypeDef* hdma) {
+    ButtonLadderAdc* adc = (ButtonLadderAdc*)hdma->Parent;
+    ButtonTime now = Button_Time_Now();
+
+    for (uint32_t c = 0; c < adc->_count; c++) {
+        ButtonLadder* ladder = adc->_ladders[c];
+        uint32_t sum = 0;
+        for (uint32_t s = 0; s < BUTTON_LADDER_AVERAGE; s++) {
+            sum += adc->_buffer[s * adc->_count + c];
+        }
+        Button_Ladder_Decode(ladder, sum / BUTTON_LADDER_AVERAGE);
+        uint32_t sample = (ladder->_current == BUTTON_LADDER_NONE) ? 0 : 1U << ladder->_current;
+        Button_Port_Debounce(&ladder->_port, sample, now);
+    }
+}
+
+
+/**
+ * @brief Initializes a ladder.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @param channel ADC channel of the pin, 1 to 18.
+ * @param levels ADC code of each button, 12-bit.
+ * @param count Number of buttons, at most BUTTON_LADDER_LEVELS.
+ * @param idle ADC code with no button pressed.
+ * @param hysteresis Codes a reading must be closer to a new level to switch.
+ * @return HAL_OK, or HAL_ERROR if there are too many buttons.
+ */
+HAL_StatusTypeDef Button_Ladder_Init(ButtonLadder* ladder, uint8_t channel, const uint16_t* levels, uint8_t count,
+                                     uint16_t idle, uint16_t hysteresis) {
+    if (count > BUTTON_LADDER_LEVELS || channel == 0 || channel > 18) {
+        return HAL_ERROR;
+    }
+
+    ladder->channel = channel;
+    ladder->levels = levels;
+    ladder->count = count;
+    ladder->idle = idle;
+    ladder->hysteresis = hysteresis;
+    ladder->_code = idle;
+    ladder->_current = BUTTON_LADDER_NONE;
+    Button_Port_Init(&ladder->_port, NULL, 0);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Lets a ladder drive a button.
+ *
+ * The button pin is set to the bit of the level in the debouncer.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @param button Initialized button.
+ * @param index Index of the button in the level table.
+ * @return HAL_OK, or HAL_ERROR if the index is not in the level table.
+ */
+HAL_StatusTypeDef Button_Ladder_Attach(ButtonLadder* ladder, Button* button, uint8_t index) {
+    if (index >= ladder->count) {
+        return HAL_ERROR;
+    }
+
+    button->GPIO_Port = NULL;
+    button->_pin = 1U << index;
+    Button_Port_Attach(&ladder->_port, button);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Calibrates the ADC and starts the triggered conversions.
+ *
+ * The ADC is clocked from HCLK / 2. Overruns overwrite the data register,
+ * so a late DMA never stalls the conversions.
+ *
+ * @param adc Pointer to the ButtonLadderAdc structure.
+ * @param instance ADC1 to ADC4.
+ * @param ladders Ladders to convert, in sequence order; the array must stay valid.
+ * @param count Number of ladders, at most BUTTON_LADDER_CHANNELS.
+ * @param hdma Circular DMA channel of the ADC.
+ * @param htim Initialized timer with its update as trigger output.
+ * @param extsel External trigger of the timer TRGO (EXTSEL code, reference manual).
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Ladder_Start(ButtonLadderAdc* adc, ADC_TypeDef* instance, ButtonLadder** ladders,
+                                      uint8_t count, DMA_HandleTypeDef* hdma, TIM_HandleTypeDef* htim,
+                                      uint8_t extsel) {
+    HAL_StatusTypeDef status;
+
+    if (count == 0 || count > BUTTON_LADDER_CHANNELS) {
+        return HAL_ERROR;
+    }
+
+    adc->instance = instance;
+    adc->hdma = hdma;
+    adc->htim = htim;
+    adc->_ladders = ladders;
+    adc->_count = count;
+
+    if (instance == ADC1 || instance == ADC2) {
+        __HAL_RCC_ADC12_CLK_ENABLE();
+        MODIFY_REG(ADC12_COMMON->CCR, ADC_CCR_CKMODE, ADC_CCR_CKMODE_1);
+    } else {
+        __HAL_RCC_ADC34_CLK_ENABLE();
+        MODIFY_REG(ADC34_COMMON->CCR, ADC_CCR_CKMODE, ADC_CCR_CKMODE_1);
+    }
+
+    // Voltage regulator on (through the intermediate state), then calibrate
+    instance->CR = 0;
+    instance->CR = ADC_CR_ADVREGEN_0;
+    HAL_Delay(1);
+    instance->CR |= ADC_CR_ADCAL;
+    status = Button_Ladder_Wait(&instance->CR, ADC_CR_ADCAL, 0);
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    uint32_t sqr1 = (count - 1U) << ADC_SQR1_L_Pos;
+    for (uint32_t c = 0; c < count; c++) {
+        uint32_t channel = ladders[c]->channel;
+        sqr1 |= channel << (ADC_SQR1_SQ1_Pos + 6 * c);
+        if (channel < 10) {
+            MODIFY_REG(instance->SMPR1, 7U << (3 * channel), BUTTON_LADDER_SMP << (3 * channel));
+        } else {
+            MODIFY_REG(instance->SMPR2, 7U << (3 * (channel - 10)), BUTTON_LADDER_SMP << (3 * (channel - 10)));
+        }
+    }
+    instance->SQR1 = sqr1;
+    instance->CFGR = ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_OVRMOD | ADC_CFGR_EXTEN_0 |
+                     ((uint32_t)extsel << ADC_CFGR_EXTSEL_Pos);
+
+    instance->ISR = ADC_ISR_ADRDY;
+    instance->CR |= ADC_CR_ADEN;
+    status = Button_Ladder_Wait(&instance->ISR, ADC_ISR_ADRDY, ADC_ISR_ADRDY);
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    hdma->Parent = adc;
+    hdma->XferHalfCpltCallback = NULL;
+    hdma->XferCpltCallback = Button_Ladder_Complete;
+    status = HAL_DMA_Start_IT(hdma, (uint32_t)&instance->DR, (uint32_t)adc->_buffer,
+                              BUTTON_LADDER_AVERAGE * count);
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    instance->CR |= ADC_CR_ADSTART;
+    if (htim->State == HAL_TIM_STATE_READY) {
+        return HAL_TIM_Base_Start(htim);
+    }
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Stops the conversions and disables the ADC.
+ *
+ * @param adc Pointer to the ButtonLadderAdc structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Ladder_Stop(ButtonLadderAdc* adc) {
+    ADC_TypeDef* instance = adc->instance;
+    HAL_StatusTypeDef status;
+
+    instance->CR |= ADC_CR_ADSTP;
+    status = Button_Ladder_Wait(&instance->CR, ADC_CR_ADSTP, 0);
+    if (status != HAL_OK) {
+        return status;
+    }
+    instance->CR |= ADC_CR_ADDIS;
+    status = Button_Ladder_Wait(&instance->CR, ADC_CR_ADEN, 0);
+    if (status != HAL_OK) {
+        return status;
+    }
+    return HAL_DMA_Abort(adc->hdma);
+}
+
+
+/**
+ * @brief Returns the button decoded from the last reading, before debouncing.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @return Button index, or BUTTON_LADDER_NONE.
+ */
+uint8_t Button_Ladder_Level(ButtonLadder* ladder) {
+    return ladder->_current;
+}
+
+
+/**
+ * @brief Returns the last averaged ADC code, for level tuning.
+ *
+ * @param ladder Pointer to the ButtonLadder structure.
+ * @return 12-bit code.
+ */
+uint16_t Button_Ladder_Code(ButtonLadder* ladder) {
+    return ladder->_code;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file button_matrix.c
+ *
+ * @brief Row/column matrix keypads scanned by timer-triggered DMA.
+ *
+ * @details The first compare of the timer comes before its first update, so
+ * row 0 is driven by hand at start and the DMA patterns are rotated by one
+ * row: the update ending period k drives the row sampled in period k + 1,
+ * and _samples[i] always belongs to row i.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_matrix.h"
+
+
+/**
+ * @brief Returns the BSRR value driving one row low and the others high.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param row Row index.
+ * @return BSRR value.
+ */
+static uint32_t Button_Matrix_Pattern(ButtonMatrix* matrix, uint32_t row) {
+    uint32_t pins = matrix->row_mask;
+
+    for (uint32_t i = 0; i < row; i++) {
+        pins &= pins - 1;
+    }
+    uint32_t bit = pins & -pins;
+    return (bit << 16) | (matrix->row_mask & ~bit);
+}
+
+
+/**
+ * @brief Turns a column IDR sample into pressed column bits 0 to 7.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param sample Column port IDR.
+ * @return Pressed columns.
+ */
+static uint32_t Button_Matrix_Columns(ButtonMatrix* matrix, uint32_t sample) {
+    uint32_t pressed = ~sample & matrix->col_mask;
+    uint32_t cols = 0;
+    uint32_t col = 0;
+
+    for (uint32_t pins = matrix->col_mask; pins != 0; pins &= pins - 1, col++) {
+        if (pressed & pins & -pins) {
+            cols |= 1U << col;
+        }
+    }
+    return cols;
+}
+
+
+/**
+ * @brief DMA transfer complete callback: a full scan is ready.
+ *
+ * A scan where two rows share two pressed columns is ambiguous (one of the
+ * four keys may be a ghost) and is dropped.
+ *
+ * @param hdma Column DMA handle, its Parent is the ButtonMatrix.
+ */
+static void Button_Matrix_Complete(DMA_HandleTypeDef* hdma) {
+    ButtonMatrix* matrix = (ButtonMatrix*)hdma->Parent;
+    uint32_t rows[BUTTON_MATRIX_ROWS] = {0};
+
+    for (uint32_t r = 0; r < matrix->_rows; r++) {
+        rows[r] = Button_Matrix_Columns(matrix, matrix->_samples[r]);
+        for (uint32_t i = 0; i < r; i++) {
+            uint32_t shared = rows[i] & rows[r];
+            if (shared & (shared - 1)) {
+                matrix->_ghosts++;
+                return;
+            }
+        }
+    }
+
+    ButtonTime now = Button_Time_Now();
+    for (uint32_t p = 0; p < (matrix->_rows + 1U) / 2; p++) {
+        Button_Port_Debounce(&matrix->_ports[p], rows[2 * p] | (rows[2 * p + 1] << 8), now);
+    }
+}
+
+
+/**
+ * @brief Initializes a keypad.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param row_port GPIO port of the rows.
+ * @param row_mask Row pins, at most 8.
+ * @param col_port GPIO port of the columns.
+ * @param col_mask Column pins, at most 8.
+ * @return HAL_OK, or HAL_ERROR if the keypad is too large.
+ */
+HAL_StatusTypeDef Button_Matrix_Init(ButtonMatrix* matrix, GPIO_TypeDef* row_port, uint16_t row_mask,
+                                     GPIO_TypeDef* col_port, uint16_t col_mask) {
+    uint32_t rows = __builtin_popcount(row_mask);
+
+    if (rows == 0 || rows > BUTTON_MATRIX_ROWS || __builtin_popcount(col_mask) > BUTTON_MATRIX_COLS) {
+        return HAL_ERROR;
+    }
+
+    matrix->row_port = row_port;
+    matrix->col_port = col_port;
+    matrix->row_mask = row_mask;
+    matrix->col_mask = col_mask;
+    matrix->htim = NULL;
+    matrix->hdma_rows = NULL;
+    matrix->hdma_cols = NULL;
+    matrix->_cols_request = 0;
+    matrix->_rows = rows;
+    matrix->_ghosts = 0;
+
+    for (uint32_t r = 0; r < BUTTON_MATRIX_ROWS; r++) {
+        matrix->_patterns[r] = (r < rows) ? Button_Matrix_Pattern(matrix, (r + 1) % rows) : 0;
+        matrix->_samples[r] = 0xFFFF;
+    }
+    for (uint32_t p = 0; p < BUTTON_MATRIX_ROWS / 2; p++) {
+        Button_Port_Init(&matrix->_ports[p], NULL, 0);
+    }
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Lets the keypad drive a button.
+ *
+ * The button pin is set to the bit of the key in its debouncer.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param button Initialized button.
+ * @param row Row of the key.
+ * @param col Column of the key.
+ * @return HAL_OK, or HAL_ERROR if the key is outside the keypad.
+ */
+HAL_StatusTypeDef Button_Matrix_Attach(ButtonMatrix* matrix, Button* button, uint8_t row, uint8_t col) {
+    if (row >= matrix->_rows || col >= __builtin_popcount(matrix->col_mask)) {
+        return HAL_ERROR;
+    }
+
+    button->GPIO_Port = NULL;
+    button->_pin = 1U << ((row & 1) * 8 + col);
+    Button_Port_Attach(&matrix->_ports[row / 2], button);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Starts scanning.
+ *
+ * The DMA handles must not be linked to a HAL peripheral driver, since the
+ * Parent and callbacks of the column channel are used by the keypad.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @param htim Initialized timer, not running.
+ * @param hdma_rows Circular DMA channel on the timer update request.
+ * @param hdma_cols Circular DMA channel on the timer compare request.
+ * @param cols_request Timer DMA request of hdma_cols (TIM_DMA_CC1...).
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Matrix_Start(ButtonMatrix* matrix, TIM_HandleTypeDef* htim, DMA_HandleTypeDef* hdma_rows,
+                                      DMA_HandleTypeDef* hdma_cols, uint32_t cols_request) {
+    HAL_StatusTypeDef status;
+
+    matrix->htim = htim;
+    matrix->hdma_rows = hdma_rows;
+    matrix->hdma_cols = hdma_cols;
+    matrix->_cols_request = cols_request;
+
+    hdma_cols->Parent = matrix;
+    hdma_cols->XferHalfCpltCallback = NULL;
+    hdma_cols->XferCpltCallback = Button_Matrix_Complete;
+
+    matrix->row_port->BSRR = Button_Matrix_Pattern(matrix, 0);
+    status = HAL_DMA_Start(hdma_rows, (uint32_t)matrix->_patterns, (uint32_t)&matrix->row_port->BSRR,
+                           matrix->_rows);
+    if (status != HAL_OK) {
+        return status;
+    }
+    status = HAL_DMA_Start_IT(hdma_cols, (uint32_t)&matrix->col_port->IDR, (uint32_t)matrix->_samples,
+                              matrix->_rows);
+    if (status != HAL_OK) {
+        HAL_DMA_Abort(hdma_rows);
+        return status;
+    }
+
+    __HAL_TIM_SET_COUNTER(htim, 0);
+    __HAL_TIM_ENABLE_DMA(htim, TIM_DMA_UPDATE | cols_request);
+    return HAL_TIM_Base_Start(htim);
+}
+
+
+/**
+ * @brief Stops scanning and releases the rows.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Matrix_Stop(ButtonMatrix* matrix) {
+    HAL_TIM_Base_Stop(matrix->htim);
+    __HAL_TIM_DISABLE_DMA(matrix->htim, TIM_DMA_UPDATE | matrix->_cols_request);
+    HAL_DMA_Abort(matrix->hdma_rows);
+    matrix->row_port->BSRR = matrix->row_mask;
+    return HAL_DMA_Abort(matrix->hdma_cols);
+}
+
+
+/**
+ * @brief Returns the debounced key bitmap.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @return Bit row * 8 + col set for each pressed key.
+ */
+uint64_t Button_Matrix_State(ButtonMatrix* matrix) {
+    uint64_t state = 0;
+
+    for (uint32_t p = 0; p < BUTTON_MATRIX_ROWS / 2; p++) {
+        state |= (uint64_t)Button_Port_State(&matrix->_ports[p]) << (16 * p);
+    }
+    return state;
+}
+
+
+/**
+ * @brief Returns the number of scans dropped because of ghosting.
+ *
+ * @param matrix Pointer to the ButtonMatrix structure.
+ * @return Ghosted scans since initialization.
+ */
+uint32_t Button_Matrix_Ghosts(ButtonMatrix* matrix) {
+    return matrix->_ghosts;
+}
@@ -0,0 +1,254 @@
+/**
+ * @file button_port.c
+ *
+ * @brief Port-level button debouncing for STM32.
+ *
+ * @details Vertical engine: each pin owns a 2-bit down counter spread over
+ * the _cnt1/_cnt0 planes. The counter of a pin whose sample differs from its
+ * debounced state counts down 3, 2, 1, 0 and toggles the state when it wraps
+ * back to 3; any sample equal to the debounced state reloads it to 3.
+ *
+ * Integrator engine: four pins are packed per word, one byte each. A sample
+ * adds or subtracts BUTTON_PORT_STEP with __UQADD8/__UQSUB8, then __USUB8 and
+ * __SEL compare all four bytes against their thresholds at once.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_port.h"
+
+
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+/**
+ * @brief Spreads the 4 low bits of a mask to 4 bytes (bit n -> 0xFF in byte n).
+ *
+ * @param bits Mask, only bits 0 to 3 are used.
+ * @return Byte lane mask.
+ */
+static inline uint32_t Button_Port_Expand(uint32_t bits) {
+    return ((bits & 0xF) * 0x00204081U & 0x01010101U) * 0xFF;
+}
+
+
+/**
+ * @brief Gathers bit 0 of 4 bytes into a 4-bit mask (inverse of Button_Port_Expand).
+ *
+ * @param lanes Byte lane mask.
+ * @return Mask in bits 0 to 3.
+ */
+static inline uint32_t Button_Port_Compress(uint32_t lanes) {
+    return ((lanes & 0x01010101U) * 0x10204080U) >> 28;
+}
+#endif
+
+
+/**
+ * @brief Initializes a port debouncer.
+ *
+ * The debounced state starts from the current pin levels, so buttons already
+ * held at start-up do not generate a press event.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param GPIO_Port GPIO port to sample, or NULL for samples pushed with Button_Port_Debounce.
+ * @param active_low Mask of the pins that read 0 when pressed.
+ */
+void Button_Port_Init(ButtonPort* port, GPIO_TypeDef* GPIO_Port, uint16_t active_low) {
+    port->GPIO_Port = GPIO_Port;
+    port->_active_low = active_low;
+    port->_state = 0;
+    port->_pressed = 0;
+    port->_released = 0;
+    for (uint32_t i = 0; i < BUTTON_PORT_PINS; i++) {
+        port->_buttons[i] = NULL;
+    }
+
+    if (GPIO_Port != NULL) {
+        port->_state = (GPIO_Port->IDR ^ port->_active_low) & 0xFFFF;
+    }
+
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+    for (uint32_t i = 0; i < BUTTON_PORT_PINS / 4; i++) {
+        // Pressed pins start full so they do not release on the first sample
+        port->_level[i] = Button_Port_Expand(port->_state >> (4 * i));
+        port->_on[i] = BUTTON_PORT_ON_THRESHOLD * 0x01010101U;
+        port->_off[i] = BUTTON_PORT_OFF_THRESHOLD * 0x01010101U;
+    }
+#else
+    port->_cnt0 = 0xFFFFFFFF;
+    port->_cnt1 = 0xFFFFFFFF;
+#endif
+}
+
+
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+/**
+ * @brief Sets the integrator thresholds of some pins.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param pins Mask of the pins to configure.
+ * @param on Level at or above which a pin becomes pressed.
+ * @param off Level at or below which a pin becomes released (lower than on).
+ */
+void Button_Port_Set_Thresholds(ButtonPort* port, uint16_t pins, uint8_t on, uint8_t off) {
+    for (uint32_t i = 0; i < BUTTON_PORT_PINS / 4; i++) {
+        uint32_t lanes = Button_Port_Expand(pins >> (4 * i));
+        port->_on[i] = (port->_on[i] & ~lanes) | ((on * 0x01010101U) & lanes);
+        port->_off[i] = (port->_off[i] & ~lanes) | ((off * 0x01010101U) & lanes);
+    }
+}
+#endif
+
+
+/**
+ * @brief Lets a port debouncer drive a button.
+ *
+ * The button stops sampling its pin and its own debounce delay is disabled.
+ * It receives GPIO_PIN_RESET when pressed, whatever the pin polarity.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param button Button initialized on the same port and pin.
+ */
+void Button_Port_Attach(ButtonPort* port, Button* button) {
+    uint32_t pin = __CLZ(__RBIT(button->_pin));
+
+    button->_source = BUTTON_SOURCE_PORT;
+    button->_delay = 0;
+    button->_state = (port->_state & button->_pin) ? GPIO_PIN_RESET : GPIO_PIN_SET;
+    port->_buttons[pin] = button;
+}
+
+
+#if BUTTON_PORT_ENGINE == BUTTON_PORT_ENGINE_INTEGRATOR
+/**
+ * @brief Runs the integrators on one sample.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param pressed Sampled pins, 1 = pressed.
+ * @return Mask of the pins whose debounced state toggled.
+ */
+static uint32_t Button_Port_Filter(ButtonPort* port, uint32_t pressed) {
+    const uint32_t step = BUTTON_PORT_STEP * 0x01010101U;
+    uint32_t state = 0;
+
+    for (uint32_t i = 0; i < BUTTON_PORT_PINS / 4; i++) {
+        uint32_t lanes = Button_Port_Expand(pressed >> (4 * i));
+        uint32_t level = port->_level[i];
+
+        level = __UQADD8(level, lanes & step);
+        level = __UQSUB8(level, ~lanes & step);
+        port->_level[i] = level;
+
+        // GE flags set where level >= on, then where off >= level
+        __USUB8(level, port->_on[i]);
+        uint32_t above = __SEL(0xFFFFFFFF, 0);
+        __USUB8(port->_off[i], level);
+        uint32_t below = __SEL(0xFFFFFFFF, 0);
+
+        // Between the thresholds the pin keeps its previous state
+        uint32_t held = Button_Port_Expand(port->_state >> (4 * i));
+        state |= Button_Port_Compress((held | above) & ~below) << (4 * i);
+    }
+
+    uint32_t delta = state ^ port->_state;
+    port->_state = state;
+    return delta;
+}
+#else
+/**
+ * @brief Runs the vertical counters on one sample.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param pressed Sampled pins, 1 = pressed.
+ * @return Mask of the pins whose debounced state toggled.
+ */
+static uint32_t Button_Port_Filter(ButtonPort* port, uint32_t pressed) {
+    uint32_t delta = pressed ^ port->_state;
+
+    port->_cnt0 = ~(port->_cnt0 & delta);
+    port->_cnt1 = port->_cnt0 ^ (port->_cnt1 & delta);
+    delta &= port->_cnt0 & port->_cnt1;
+    port->_state ^= delta;
+    return delta;
+}
+#endif
+
+
+/**
+ * @brief Debounces one sample of a port and updates the attached buttons.
+ *
+ * Only the buttons whose debounced state changed are visited.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @param sample Raw pin levels.
+ * @param now Current time (Button_Time_Now).
+ * @return Mask of the pins whose debounced state changed.
+ */
+uint32_t Button_Port_Debounce(ButtonPort* port, uint32_t sample, ButtonTime now) {
+    uint32_t changed = Button_Port_Filter(port, (sample ^ port->_active_low) & 0xFFFF);
+
+    port->_pressed = changed & port->_state;
+    port->_released = changed & ~port->_state;
+
+    for (uint32_t pending = changed; pending != 0; pending &= pending - 1) {
+        uint32_t pin = __CLZ(__RBIT(pending));
+        Button* button = port->_buttons[pin];
+        if (button != NULL) {
+            Button_Update(button, (port->_state & (1U << pin)) ? GPIO_PIN_RESET : GPIO_PIN_SET, now);
+        }
+    }
+    return changed;
+}
+
+
+/**
+ * @brief Samples and debounces an array of GPIO ports.
+ *
+ * Call it every BUTTON_PORT_TICK_MS, from the main loop or a timer interrupt.
+ * Ports without a GPIO_Port are skipped.
+ *
+ * @param ports Array of ButtonPort structures.
+ * @param count Number of ports in the array.
+ */
+void Button_Port_Tick(ButtonPort* ports, uint32_t count) {
+    ButtonTime now = Button_Time_Now();
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (ports[i].GPIO_Port != NULL) {
+            Button_Port_Debounce(&ports[i], ports[i].GPIO_Port->IDR, now);
+        }
+    }
+}
+
+
+/**
+ * @brief Returns the debounced state of a port.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @return Mask of the pressed pins.
+ */
+uint32_t Button_Port_State(ButtonPort* port) {
+    return port->_state;
+}
+
+
+/**
+ * @brief Returns the pins pressed during the last tick.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @return Mask of the newly pressed pins.
+ */
+uint32_t Button_Port_Pressed(ButtonPort* port) {
+    return port->_pressed;
+}
+
+
+/**
+ * @brief Returns the pins released during the last tick.
+ *
+ * @param port Pointer to the ButtonPort structure.
+ * @return Mask of the newly released pins.
+ */
+uint32_t Button_Port_Released(ButtonPort* port) {
+    return port->_released;
+}
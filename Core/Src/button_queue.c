@@ -0,0 +1,131 @@
+/**
+ * @file button_queue.c
+ *
+ * @brief Lock-free event queue between button interrupts and the main loop.
+ *
+ * @details Every slot carries a sequence number. A slot at position pos is
+ * free when its sequence equals pos, and holds a published event when it
+ * equals pos + 1. Producers reserve a position by advancing _head with
+ * LDREX/STREX, fill the slot, then publish it; an exception between LDREX and
+ * STREX clears the exclusive monitor, so a preempted producer simply retries.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_queue.h"
+
+
+/**
+ * @brief Atomically increments a counter shared between interrupts.
+ *
+ * @param counter Pointer to the counter.
+ */
+static BUTTON_CCM_CODE void Button_Queue_Atomic_Inc(volatile uint32_t* counter) {
+    uint32_t value;
+    do {
+        value = __LDREXW(counter);
+    } while (__STREXW(value + 1, counter) != 0);
+}
+
+
+/**
+ * @brief Initializes an empty queue.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ */
+void Button_Queue_Init(ButtonQueue* queue) {
+    queue->_head = 0;
+    queue->_tail = 0;
+    queue->_overflow_count = 0;
+    for (uint32_t i = 0; i < BUTTON_QUEUE_SIZE; i++) {
+        queue->_slots[i]._seq = i;
+    }
+}
+
+
+/**
+ * @brief Adds an event to the queue.
+ *
+ * Can be called from several interrupts at different priorities and from the
+ * main loop at the same time.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ * @param event Event to copy into the queue.
+ * @return 1 if the event was queued, 0 if the queue was full.
+ */
+BUTTON_CCM_CODE uint8_t Button_Queue_Push(ButtonQueue* queue, const ButtonEvent* event) {
+    ButtonQueueSlot* slot;
+    uint32_t pos;
+
+    for (;;) {
+        pos = __LDREXW(&queue->_head);
+        slot = &queue->_slots[pos & (BUTTON_QUEUE_SIZE - 1)];
+        int32_t dif = (int32_t)(slot->_seq - pos);
+        if (dif < 0) {
+            // The consumer has not freed this slot yet: queue is full
+            __CLREX();
+            Button_Queue_Atomic_Inc(&queue->_overflow_count);
+            return 0;
+        }
+        if (dif > 0) {
+            // A preempting producer already took this position, reload the head
+            __CLREX();
+            continue;
+        }
+        if (__STREXW(pos + 1, &queue->_head) == 0) {
+            break;
+        }
+    }
+
+    // The slot is ours, fill it and publish it to the consumer
+    slot->_event = *event;
+    __DMB();
+    slot->_seq = pos + 1;
+    return 1;
+}
+
+
+/**
+ * @brief Removes up to max events from the queue.
+ *
+ * Stops early at a slot that is reserved but not yet published, so events are
+ * always returned in order. Must only be called from one context.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ * @param events Output array for the events, oldest first.
+ * @param max Capacity of the events array.
+ * @return Number of events copied to events.
+ */
+uint32_t Button_Queue_Drain(ButtonQueue* queue, ButtonEvent* events, uint32_t max) {
+    uint32_t pos = queue->_tail;
+    uint32_t count = 0;
+
+    while (count < max) {
+        ButtonQueueSlot* slot = &queue->_slots[pos & (BUTTON_QUEUE_SIZE - 1)];
+        if (slot->_seq != pos + 1) {
+            // Empty, or the producer has not finished writing yet
+            break;
+        }
+        __DMB();
+        events[count++] = slot->_event;
+        __DMB();
+        // Hand the slot back to producers for the next lap
+        slot->_seq = pos + BUTTON_QUEUE_SIZE;
+        pos++;
+    }
+
+    queue->_tail = pos;
+    return count;
+}
+
+
+/**
+ * @brief Returns the number of events dropped because the queue was full.
+ *
+ * @param queue Pointer to the ButtonQueue structure.
+ * @return Overflow count since initialization.
+ */
+uint32_t Button_Queue_Overflows(ButtonQueue* queue) {
+    return queue->_overflow_count;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file button_scan.c
+ *
+ * @brief Timer and DMA driven sampling of button ports.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_scan.h"
+
+
+/**
+ * @brief Reduces half a buffer to one sample and debounces it.
+ *
+ * A pin that stayed at the same level over all the samples takes that level.
+ * A pin that changed within the window is reported at its current debounced
+ * state, which restarts its debounce.
+ *
+ * @param scan Pointer to the ButtonScan structure.
+ * @param samples First sample of the finished half.
+ */
+static void Button_Scan_Process(ButtonScan* scan, const uint16_t* samples) {
+    ButtonPort* port = scan->_port;
+    uint32_t first = samples[0];
+    uint32_t unstable = 0;
+
+    for (uint32_t i = 1; i < BUTTON_SCAN_SAMPLES; i++) {
+        unstable |= samples[i] ^ first;
+    }
+
+    uint32_t held = port->_state ^ port->_active_low;
+    uint32_t sample = (first & ~unstable) | (held & unstable);
+    Button_Port_Debounce(port, sample, Button_Time_Now());
+}
+
+
+/**
+ * @brief DMA half transfer callback: the first half is ready.
+ *
+ * @param hdma DMA handle, its Parent is the ButtonScan.
+ */
+static void Button_Scan_Half_Complete(DMA_HandleTypeDef* hdma) {
+    ButtonScan* scan = (ButtonScan*)hdma->Parent;
+    Button_Scan_Process(scan, &scan->_buffer[0]);
+}
+
+
+/**
+ * @brief DMA transfer complete callback: the second half is ready.
+ *
+ * @param hdma DMA handle, its Parent is the ButtonScan.
+ */
+static void Button_Scan_Complete(DMA_HandleTypeDef* hdma) {
+    ButtonScan* scan = (ButtonScan*)hdma->Parent;
+    Button_Scan_Process(scan, &scan->_buffer[BUTTON_SCAN_SAMPLES]);
+}
+
+
+/**
+ * @brief Starts sampling a port with a timer and a DMA channel.
+ *
+ * The DMA handle must not be linked to a HAL peripheral driver, since its
+ * Parent and callbacks are used by the scanner.
+ *
+ * @param scan Pointer to the ButtonScan structure.
+ * @param htim Initialized timer; it is started by this function.
+ * @param dma_request Timer DMA request linked to the DMA channel (TIM_DMA_UPDATE, TIM_DMA_CC1...).
+ * @param hdma Initialized circular DMA channel.
+ * @param port Port debouncer, initialized with the GPIO port to sample.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Scan_Start(ButtonScan* scan, TIM_HandleTypeDef* htim, uint32_t dma_request,
+                                    DMA_HandleTypeDef* hdma, ButtonPort* port) {
+    HAL_StatusTypeDef status;
+
+    scan->htim = htim;
+    scan->hdma = hdma;
+    scan->_dma_request = dma_request;
+    scan->_port = port;
+
+    hdma->Parent = scan;
+    hdma->XferHalfCpltCallback = Button_Scan_Half_Complete;
+    hdma->XferCpltCallback = Button_Scan_Complete;
+
+    status = HAL_DMA_Start_IT(hdma, (uint32_t)&port->GPIO_Port->IDR, (uint32_t)scan->_buffer,
+                              2 * BUTTON_SCAN_SAMPLES);
+    if (status != HAL_OK) {
+        return status;
+    }
+
+    __HAL_TIM_ENABLE_DMA(htim, dma_request);
+    if (htim->State == HAL_TIM_STATE_READY) {
+        status = HAL_TIM_Base_Start(htim);
+    }
+    return status;
+}
+
+
+/**
+ * @brief Stops the DMA transfer. The timer keeps running for other users.
+ *
+ * @param scan Pointer to the ButtonScan structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Scan_Stop(ButtonScan* scan) {
+    __HAL_TIM_DISABLE_DMA(scan->htim, scan->_dma_request);
+    return HAL_DMA_Abort(scan->hdma);
+}
@@ -0,0 +1,199 @@
+/**
+ * @file button_shift.c
+ *
+ * @brief Buttons on daisy-chained 74HC165 shift registers, clocked by DMA.
+ *
+ * @details Period 0 holds SH/LD low to load the inputs, period 1 releases it
+ * and the first bit is on QH. Each following pair of periods raises then
+ * lowers the clock, so input n is always sampled in period 2n + 1 with the
+ * clock low. As for the matrix keypad, the first compare comes before the
+ * first update: period 0 is driven by hand at start and the DMA patterns
+ * are rotated by one period.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_shift.h"
+
+
+/**
+ * @brief Returns the BSRR value of the load and clock lines during a period.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param period Period of the scan.
+ * @return BSRR value.
+ */
+static uint32_t Button_Shift_Pattern(ButtonShift* shift, uint32_t period) {
+    uint32_t set = 0;
+    uint32_t reset = 0;
+
+    if (period == 0) {
+        reset |= shift->load_pin;
+    } else {
+        set |= shift->load_pin;
+    }
+    if (period >= 2 && (period & 1) == 0) {
+        set |= shift->clock_pin;
+    } else {
+        reset |= shift->clock_pin;
+    }
+    return (reset << 16) | set;
+}
+
+
+/**
+ * @brief DMA transfer complete callback: a full scan is ready.
+ *
+ * @param hdma Data DMA handle, its Parent is the ButtonShift.
+ */
+static void Button_Shift_Complete(DMA_HandleTypeDef* hdma) {
+    ButtonShift* shift = (ButtonShift*)hdma->Parent;
+    ButtonTime now = Button_Time_Now();
+    uint32_t inputs = 8U * shift->_chips;
+
+    for (uint32_t first = 0; first < inputs; first += 16) {
+        uint32_t sample = 0;
+        for (uint32_t n = 0; n < 16 && first + n < inputs; n++) {
+            if (shift->_samples[2 * (first + n) + 1] & shift->data_pin) {
+                sample |= 1U << n;
+            }
+        }
+        Button_Port_Debounce(&shift->_ports[first / 16], sample, now);
+    }
+}
+
+
+/**
+ * @brief Initializes a shift register chain.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param chips Registers in the chain, 1 to BUTTON_SHIFT_CHIPS.
+ * @param ctrl_port GPIO port of the load and clock lines.
+ * @param load_pin SH/LD pin.
+ * @param clock_pin CLK pin.
+ * @param data_port GPIO port of the data line.
+ * @param data_pin QH pin.
+ * @param active_low 1 if the inputs read 0 when pressed.
+ * @return HAL_OK, or HAL_ERROR if the chain is too long.
+ */
+HAL_StatusTypeDef Button_Shift_Init(ButtonShift* shift, uint8_t chips, GPIO_TypeDef* ctrl_port, uint16_t load_pin,
+                                    uint16_t clock_pin, GPIO_TypeDef* data_port, uint16_t data_pin,
+                                    uint8_t active_low) {
+    if (chips == 0 || chips > BUTTON_SHIFT_CHIPS) {
+        return HAL_ERROR;
+    }
+
+    shift->ctrl_port = ctrl_port;
+    shift->load_pin = load_pin;
+    shift->clock_pin = clock_pin;
+    shift->data_port = data_port;
+    shift->data_pin = data_pin;
+    shift->htim = NULL;
+    shift->hdma_ctrl = NULL;
+    shift->hdma_data = NULL;
+    shift->_data_request = 0;
+    shift->_chips = chips;
+
+    uint32_t periods = 16U * chips;
+    for (uint32_t i = 0; i < BUTTON_SHIFT_PERIODS; i++) {
+        shift->_patterns[i] = (i < periods) ? Button_Shift_Pattern(shift, (i + 1) % periods) : 0;
+        shift->_samples[i] = 0;
+    }
+    for (uint32_t p = 0; p < (BUTTON_SHIFT_INPUTS + 15) / 16; p++) {
+        Button_Port_Init(&shift->_ports[p], NULL, active_low ? 0xFFFF : 0);
+    }
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Lets the chain drive a button.
+ *
+ * The button pin is set to the bit of the input in its debouncer.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param button Initialized button.
+ * @param input Input of the chain.
+ * @return HAL_OK, or HAL_ERROR if the input is past the end of the chain.
+ */
+HAL_StatusTypeDef Button_Shift_Attach(ButtonShift* shift, Button* button, uint8_t input) {
+    if (input >= 8U * shift->_chips) {
+        return HAL_ERROR;
+    }
+
+    button->GPIO_Port = NULL;
+    button->_pin = 1U << (input % 16);
+    Button_Port_Attach(&shift->_ports[input / 16], button);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Starts scanning.
+ *
+ * The DMA handles must not be linked to a HAL peripheral driver, since the
+ * Parent and callbacks of the data channel are used by the chain.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param htim Initialized timer, not running.
+ * @param hdma_ctrl Circular DMA channel on the timer update request.
+ * @param hdma_data Circular DMA channel on the timer compare request.
+ * @param data_request Timer DMA request of hdma_data (TIM_DMA_CC1...).
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Shift_Start(ButtonShift* shift, TIM_HandleTypeDef* htim, DMA_HandleTypeDef* hdma_ctrl,
+                                     DMA_HandleTypeDef* hdma_data, uint32_t data_request) {
+    uint32_t periods = 16U * shift->_chips;
+    HAL_StatusTypeDef status;
+
+    shift->htim = htim;
+    shift->hdma_ctrl = hdma_ctrl;
+    shift->hdma_data = hdma_data;
+    shift->_data_request = data_request;
+
+    hdma_data->Parent = shift;
+    hdma_data->XferHalfCpltCallback = NULL;
+    hdma_data->XferCpltCallback = Button_Shift_Complete;
+
+    shift->ctrl_port->BSRR = Button_Shift_Pattern(shift, 0);
+    status = HAL_DMA_Start(hdma_ctrl, (uint32_t)shift->_patterns, (uint32_t)&shift->ctrl_port->BSRR, periods);
+    if (status != HAL_OK) {
+        return status;
+    }
+    status = HAL_DMA_Start_IT(hdma_data, (uint32_t)&shift->data_port->IDR, (uint32_t)shift->_samples, periods);
+    if (status != HAL_OK) {
+        HAL_DMA_Abort(hdma_ctrl);
+        return status;
+    }
+
+    __HAL_TIM_SET_COUNTER(htim, 0);
+    __HAL_TIM_ENABLE_DMA(htim, TIM_DMA_UPDATE | data_request);
+    return HAL_TIM_Base_Start(htim);
+}
+
+
+/**
+ * @brief Stops scanning.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @return HAL_OK on success.
+ */
+HAL_StatusTypeDef Button_Shift_Stop(ButtonShift* shift) {
+    HAL_TIM_Base_Stop(shift->htim);
+    __HAL_TIM_DISABLE_DMA(shift->htim, TIM_DMA_UPDATE | shift->_data_request);
+    HAL_DMA_Abort(shift->hdma_ctrl);
+    return HAL_DMA_Abort(shift->hdma_data);
+}
+
+
+/**
+ * @brief Returns the debounced state of 16 inputs.
+ *
+ * @param shift Pointer to the ButtonShift structure.
+ * @param first First input, multiple of 16.
+ * @return Bit n set if input first + n is pressed.
+ */
+uint32_t Button_Shift_State(ButtonShift* shift, uint8_t first) {
+    return Button_Port_State(&shift->_ports[first / 16]);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file button_time.c
+ *
+ * @brief Monotonic timebase of the button library.
+ *
+ * @details The high word counts the wraps of the 32-bit counter, detected
+ * when a reading is lower than the previous one.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_time.h"
+
+
+static volatile uint32_t button_time_high BUTTON_CCM_DATA;	/* Wraps of the 32-bit counter */
+static volatile uint32_t button_time_last BUTTON_CCM_DATA;	/* Previous reading of the counter */
+
+
+/**
+ * @brief Reads the 32-bit counter of the selected timebase.
+ *
+ * @return Counter value.
+ */
+static inline uint32_t Button_Time_Counter(void) {
+#if BUTTON_TIMEBASE == BUTTON_TIMEBASE_DWT
+    return DWT->CYCCNT;
+#elif BUTTON_TIMEBASE == BUTTON_TIMEBASE_TIM2
+    return TIM2->CNT;
+#else
+    return HAL_GetTick();
+#endif
+}
+
+
+/**
+ * @brief Starts the selected counter.
+ *
+ * TIM2 is left untouched if the application already started it (for example
+ * for input capture), in which case it must count at 1 MHz.
+ */
+void Button_Time_Init(void) {
+#if BUTTON_TIMEBASE == BUTTON_TIMEBASE_DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#elif BUTTON_TIMEBASE == BUTTON_TIMEBASE_TIM2
+    if ((TIM2->CR1 & TIM_CR1_CEN) == 0) {
+        // TIM2 runs at twice PCLK1 when APB1 is divided
+        uint32_t clock = HAL_RCC_GetPCLK1Freq();
+        if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+            clock *= 2;
+        }
+        __HAL_RCC_TIM2_CLK_ENABLE();
+        TIM2->PSC = clock / BUTTON_TIME_HZ - 1;
+        TIM2->ARR = 0xFFFFFFFF;
+        TIM2->EGR = TIM_EGR_UG;
+        TIM2->CR1 |= TIM_CR1_CEN;
+    }
+#endif
+    button_time_high = 0;
+    button_time_last = Button_Time_Counter();
+}
+
+
+/**
+ * @brief Returns the current time.
+ *
+ * Reading the counter and updating the extension is done with interrupts
+ * disabled, so the function is safe from any context.
+ *
+ * @return Ticks since start-up.
+ */
+BUTTON_CCM_CODE ButtonTime Button_Time_Now(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t low = Button_Time_Counter();
+    if (low < button_time_last) {
+        button_time_high++;
+    }
+    button_time_last = low;
+    ButtonTime now = ((ButtonTime)button_time_high << 32) | low;
+
+    __set_PRIMASK(primask);
+    return now;
+}
+
+
+/**
+ * @brief Keeps the 64-bit extension up to date.
+ *
+ * Must run at least once per wrap of the 32-bit counter.
+ */
+void Button_Time_Tick(void) {
+    (void)Button_Time_Now();
+}
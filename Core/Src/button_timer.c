@@ -0,0 +1,165 @@
+/**
+ * @file button_timer.c
+ *
+ * @brief Shared software timers of the button library.
+ *
+ * @details Level 0 holds the timers due within BUTTON_TIMER_SLOTS ticks, one
+ * slot per tick. Level 1 holds the later ones, one slot per
+ * BUTTON_TIMER_SLOTS ticks; a level 1 slot is moved down to level 0 when the
+ * tick count reaches it. Timers further than the range of level 1 are parked
+ * in its last slot and placed again when it cascades. The wheel is changed
+ * with interrupts disabled for a few instructions, as timers are started
+ * from any interrupt.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_timer.h"
+
+
+#define BUTTON_TIMER_MASK			(BUTTON_TIMER_SLOTS - 1)
+#define BUTTON_TIMER_RANGE			(BUTTON_TIMER_SLOTS * BUTTON_TIMER_SLOTS)
+
+static ButtonTimer* button_timer_wheel[2][BUTTON_TIMER_SLOTS] BUTTON_CCM_DATA;	/* Slot lists */
+static volatile uint32_t button_timer_ticks BUTTON_CCM_DATA;	/* Current tick */
+
+
+/**
+ * @brief Links a timer in the slot of its expiry. Interrupts must be disabled.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ */
+static BUTTON_CCM_CODE void Button_Timer_Link(ButtonTimer* timer) {
+    uint32_t now = button_timer_ticks;
+    uint32_t delta = timer->_expiry - now;
+    ButtonTimer** slot;
+
+    if (delta < BUTTON_TIMER_SLOTS) {
+        slot = &button_timer_wheel[0][timer->_expiry & BUTTON_TIMER_MASK];
+    } else if (delta < BUTTON_TIMER_RANGE) {
+        slot = &button_timer_wheel[1][(timer->_expiry >> BUTTON_TIMER_BITS) & BUTTON_TIMER_MASK];
+    } else {
+        slot = &button_timer_wheel[1][((now >> BUTTON_TIMER_BITS) - 1) & BUTTON_TIMER_MASK];
+    }
+
+    timer->_next = *slot;
+    if (timer->_next != NULL) {
+        timer->_next->_link = &timer->_next;
+    }
+    timer->_link = slot;
+    *slot = timer;
+}
+
+
+/**
+ * @brief Unlinks a running timer. Interrupts must be disabled.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ */
+static BUTTON_CCM_CODE void Button_Timer_Unlink(ButtonTimer* timer) {
+    *timer->_link = timer->_next;
+    if (timer->_next != NULL) {
+        timer->_next->_link = timer->_link;
+    }
+    timer->_link = NULL;
+}
+
+
+/**
+ * @brief Initializes a stopped timer.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ * @param callback Function called on expiry, from Button_Timer_Tick.
+ * @param owner Pointer passed to the callback.
+ */
+void Button_Timer_Init(ButtonTimer* timer, ButtonTimerCallback callback, void* owner) {
+    timer->_next = NULL;
+    timer->_link = NULL;
+    timer->_expiry = 0;
+    timer->_callback = callback;
+    timer->_owner = owner;
+}
+
+
+/**
+ * @brief Starts or restarts a timer.
+ *
+ * The delay is rounded up to whole ticks, at least one.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ * @param ms Delay in milliseconds.
+ */
+BUTTON_CCM_CODE void Button_Timer_Start(ButtonTimer* timer, uint32_t ms) {
+    uint32_t ticks = (ms + BUTTON_TIMER_TICK_MS - 1) / BUTTON_TIMER_TICK_MS;
+
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (timer->_link != NULL) {
+        Button_Timer_Unlink(timer);
+    }
+    timer->_expiry = button_timer_ticks + ticks;
+    Button_Timer_Link(timer);
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Stops a timer.
+ *
+ * @param timer Pointer to the ButtonTimer structure.
+ */
+BUTTON_CCM_CODE void Button_Timer_Cancel(ButtonTimer* timer) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (timer->_link != NULL) {
+        Button_Timer_Unlink(timer);
+    }
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Advances the wheel by one tick and runs the expired timers.
+ *
+ * Expired timers are taken out one at a time, so a callback may start or
+ * cancel any timer, including its own.
+ */
+void Button_Timer_Tick(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t now = ++button_timer_ticks;
+
+    if ((now & BUTTON_TIMER_MASK) == 0) {
+        // Move the level 1 slot now due down to level 0
+        ButtonTimer** slot = &button_timer_wheel[1][(now >> BUTTON_TIMER_BITS) & BUTTON_TIMER_MASK];
+        ButtonTimer* timer = *slot;
+        *slot = NULL;
+        while (timer != NULL) {
+            ButtonTimer* next = timer->_next;
+            Button_Timer_Link(timer);
+            timer = next;
+        }
+    }
+    __set_PRIMASK(primask);
+
+    ButtonTimer** slot = &button_timer_wheel[0][now & BUTTON_TIMER_MASK];
+    for (;;) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        ButtonTimer* timer = *slot;
+        if (timer != NULL) {
+            Button_Timer_Unlink(timer);
+        }
+        __set_PRIMASK(primask);
+
+        if (timer == NULL) {
+            break;
+        }
+        timer->_callback(timer->_owner);
+    }
+}
@@ -0,0 +1,211 @@
+/**
+ * @file button_touch.c
+ *
+ * @brief Capacitive touch keys on the touch sensing controller (TSC).
+ *
+ * @details The TSC HAL driver is not used: the controller is programmed
+ * through its registers. Keys are assigned to acquisitions (phases) when
+ * attached, the n-th key of a group going to phase n, so that each phase
+ * holds at most one channel per group. With IODEF cleared, the IOs are
+ * driven low between acquisitions, which discharges the electrodes and the
+ * sampling capacitors.
+ *
+ * @author deligent4
+ */
+
+
+#include "button_touch.h"
+
+
+/**
+ * @brief Returns the group index (0 to 7) of a TSC IO.
+ *
+ * @param io TSC IO mask.
+ * @return Group index.
+ */
+static inline uint32_t Button_Touch_Group(uint32_t io) {
+    return __CLZ(__RBIT(io)) / 4;
+}
+
+
+/**
+ * @brief Updates the state and baseline of a key from a new count.
+ *
+ * @param key Pointer to the ButtonTouchKey structure.
+ * @param count Acquired count.
+ * @param now Current time (Button_Time_Now).
+ */
+static void Button_Touch_Filter(ButtonTouchKey* key, uint32_t count, ButtonTime now) {
+    int32_t scaled = (int32_t)count << BUTTON_TOUCH_FRACTION;
+
+    key->_count = count;
+    if (key->_baseline == 0) {
+        key->_baseline = scaled;
+        return;
+    }
+
+    int32_t delta = (key->_baseline >> BUTTON_TOUCH_FRACTION) - (int32_t)count;
+    if (key->_touched) {
+        if (delta < (int32_t)key->threshold - key->hysteresis) {
+            key->_touched = 0;
+            Button_Update(key->button, GPIO_PIN_SET, now);
+        }
+    } else if (delta >= key->threshold) {
+        key->_touched = 1;
+        Button_Update(key->button, GPIO_PIN_RESET, now);
+    } else if (delta < 0) {
+        key->_baseline += (scaled - key->_baseline) >> BUTTON_TOUCH_RISE_SHIFT;
+    } else {
+        key->_baseline += (scaled - key->_baseline) >> BUTTON_TOUCH_DRIFT_SHIFT;
+    }
+}
+
+
+/**
+ * @brief Enables the TSC and its end of acquisition interrupt.
+ *
+ * Schmitt trigger hysteresis is disabled on the sampling IOs, as advised
+ * for analog operation; channel IOs get the same as they are attached.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ * @param sampling Sampling IOs (BUTTON_TOUCH_IO), one per used group.
+ */
+void Button_Touch_Init(ButtonTouch* touch, uint32_t sampling) {
+    touch->sampling = sampling;
+    touch->_keys = NULL;
+    touch->_phases = 0;
+    touch->_phase = 0;
+    touch->_busy = 0;
+
+    __HAL_RCC_TSC_CLK_ENABLE();
+    TSC->CR = BUTTON_TOUCH_CR | TSC_CR_TSCE;
+    TSC->IOHCR &= ~sampling;
+    TSC->IOSCR = sampling;
+    TSC->ICR = TSC_ICR_EOAIC | TSC_ICR_MCEIC;
+    TSC->IER = TSC_IER_EOAIE;
+}
+
+
+/**
+ * @brief Adds a key driving a button.
+ *
+ * The button stops sampling its pin and its own debounce delay is disabled,
+ * the hysteresis doing that job.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ * @param key Key storage, kept by the caller.
+ * @param button Initialized button.
+ * @param channel Channel IO (BUTTON_TOUCH_IO), in a group with a sampling IO.
+ * @param threshold Count drop at which the key is touched.
+ * @param hysteresis Release at threshold - hysteresis.
+ * @return HAL_OK, or HAL_ERROR if channel is not a single IO of a group with a sampling IO.
+ */
+HAL_StatusTypeDef Button_Touch_Attach(ButtonTouch* touch, ButtonTouchKey* key, Button* button, uint32_t channel,
+                                      uint16_t threshold, uint16_t hysteresis) {
+    uint8_t phase = 0;
+
+    if (channel == 0 || (channel & (channel - 1)) != 0 || (channel & touch->sampling) != 0 ||
+        (touch->sampling & (0xFU << (4 * Button_Touch_Group(channel)))) == 0) {
+        return HAL_ERROR;
+    }
+
+    for (ButtonTouchKey* other = touch->_keys; other != NULL; other = other->_next) {
+        if (Button_Touch_Group(other->channel) == Button_Touch_Group(channel)) {
+            phase++;
+        }
+    }
+
+    key->button = button;
+    key->channel = channel;
+    key->threshold = threshold;
+    key->hysteresis = (hysteresis < threshold) ? hysteresis : threshold;
+    key->_baseline = 0;
+    key->_count = 0;
+    key->_phase = phase;
+    key->_touched = 0;
+
+    button->_source = BUTTON_SOURCE_TOUCH;
+    button->_delay = 0;
+    button->_state = GPIO_PIN_SET;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TSC->IOHCR &= ~channel;
+    key->_next = touch->_keys;
+    touch->_keys = key;
+    if (phase >= touch->_phases) {
+        touch->_phases = phase + 1;
+    }
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Starts the next acquisition if the previous one is over.
+ *
+ * The time between the end of an acquisition and the next tick discharges
+ * the sampling capacitors.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ */
+void Button_Touch_Tick(ButtonTouch* touch) {
+    uint32_t channels = 0;
+    uint32_t groups = 0;
+
+    if (touch->_busy || touch->_phases == 0) {
+        return;
+    }
+
+    for (ButtonTouchKey* key = touch->_keys; key != NULL; key = key->_next) {
+        if (key->_phase == touch->_phase) {
+            channels |= key->channel;
+            groups |= 1U << Button_Touch_Group(key->channel);
+        }
+    }
+
+    touch->_busy = 1;
+    TSC->IOCCR = channels;
+    TSC->IOGCSR = groups;
+    TSC->ICR = TSC_ICR_EOAIC | TSC_ICR_MCEIC;
+    TSC->CR |= TSC_CR_START;
+}
+
+
+/**
+ * @brief Handles the end of an acquisition.
+ *
+ * Groups that reached the max count (electrode missing or shorted) have no
+ * valid count and are skipped. Does nothing for EXTI line 2 interrupts.
+ *
+ * @param touch Pointer to the ButtonTouch structure.
+ */
+void Button_Touch_IRQHandler(ButtonTouch* touch) {
+    if ((TSC->ISR & TSC_ISR_EOAF) == 0) {
+        return;
+    }
+    TSC->ICR = TSC_ICR_EOAIC | TSC_ICR_MCEIC;
+
+    ButtonTime now = Button_Time_Now();
+    uint32_t status = TSC->IOGCSR;
+    for (ButtonTouchKey* key = touch->_keys; key != NULL; key = key->_next) {
+        uint32_t group = Button_Touch_Group(key->channel);
+        if (key->_phase == touch->_phase && (status & (TSC_IOGCSR_G1S << group))) {
+            Button_Touch_Filter(key, TSC->IOGXCR[group], now);
+        }
+    }
+
+    touch->_phase = (touch->_phase + 1) % touch->_phases;
+    touch->_busy = 0;
+}
+
+
+/**
+ * @brief Returns the count drop of a key, for threshold tuning.
+ *
+ * @param key Pointer to the ButtonTouchKey structure.
+ * @return Baseline minus last count.
+ */
+int32_t Button_Touch_Delta(ButtonTouchKey* key) {
+    return (key->_baseline >> BUTTON_TOUCH_FRACTION) - (int32_t)key->_count;
+}
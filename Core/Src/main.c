@@ -22,6 +22,8 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "button.h"
+#include "button_defer.h"
+#include "button_callback.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -44,7 +46,11 @@
 /* USER CODE BEGIN PV */
 uint32_t tick = 0;
 uint8_t press_counter = 0, long_counter =0, double_counter = 0;
-Button swa, swb, swc;
+BUTTON_CCM_DATA Button swa, swb, swc;
+BUTTON_CCM_DATA ButtonQueue button_queue;
+ButtonEvent button_events[8];
+BUTTON_CCM_DATA ButtonDefer button_defer;
+ButtonSubscription swc_subscription;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -56,6 +62,14 @@ static void MX_GPIO_Init(void);
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+// Called from the main loop for the long and double presses of SWC
+static void SWC_Callback(const ButtonEvent* event, void* user) {
+	if (event->type == BUTTON_EVENT_LONG){
+		long_counter++;
+	} else {
+		double_counter++;
+	}
+}
 
 /* USER CODE END 0 */
 
@@ -88,11 +102,28 @@ int main(void)
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   /* USER CODE BEGIN 2 */
-  // Initialize buttons
+  // Start the button timebase, then initialize buttons
+  Button_Time_Init();
   Button_Init(&swa, SWA_GPIO_Port, SWA_Pin);  // Example GPIO port and pin for SWA
   Button_Init(&swb, SWB_GPIO_Port, SWB_Pin);  // Example GPIO port and pin for SWB
   Button_Init(&swc, SWC_GPIO_Port, SWC_Pin);  // Example GPIO port and pin for SWC
 
+  // SWB and SWC report through the event queue instead of being polled
+  Button_Queue_Init(&button_queue);
+  Button_Set_Queue(&swb, &button_queue);
+  Button_Set_Queue(&swc, &button_queue);
+
+  // EXTI interrupts only record the edges, PendSV runs the buttons
+  Button_Defer_Init(&button_defer);
+  Button_Defer_Attach(&button_defer, &swa);
+  Button_Defer_Attach(&button_defer, &swb);
+  Button_Defer_Attach(&button_defer, &swc);
+
+  // SWC long and double presses are delivered to a callback in the main loop
+  Button_Callback_Init();
+  Button_Subscribe(&swc, &swc_subscription, BUTTON_MASK_LONG | BUTTON_MASK_DOUBLE, BUTTON_CONTEXT_MAIN,
+		  SWC_Callback, NULL);
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -106,31 +137,36 @@ int main(void)
 
 //	  Button_IRQ_Handler(&swa);
 
-	  if (Button_Pressed(&swa))
+	  // One sample of SWA gives all its events at once
+	  uint8_t swa_events = Button_Poll(&swa);
+
+	  if (swa_events & BUTTON_MASK_PRESS)
 	  {
 		  // SWA pressed
 		  press_counter++;
 		  HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
 	  }
 
-	  if (Button_Long_Pressed(&swa)){
+	  if (swa_events & BUTTON_MASK_LONG){
 		  long_counter++;
 	  }
 
-	  if (Button_Double_Pressed(&swa)){
+	  if (swa_events & BUTTON_MASK_DOUBLE){
 		  double_counter++;
 	  }
-	  if (Button_Pressed(&swb)){
-		  // SWA pressed
-		  press_counter++;
-		  HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
-	  }
 
-	  if (Button_Pressed(&swc)){
-		  // SWA pressed
-		  press_counter++;
-		  HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
+	  // Handle every event queued by the EXTI interrupts since the last pass
+	  uint32_t count = Button_Queue_Drain(&button_queue, button_events, 8);
+	  for (uint32_t i = 0; i < count; i++){
+		  if (button_events[i].type == BUTTON_EVENT_PRESS){
+			  // SWB or SWC pressed
+			  press_counter++;
+			  HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);
+		  }
 	  }
+
+	  // Run the callbacks subscribed in main-loop context
+	  Button_Callback_Dispatch(BUTTON_CONTEXT_MAIN);
   }
   /* USER CODE END 3 */
 }
@@ -223,25 +259,10 @@ static void MX_GPIO_Init(void)
 /* USER CODE BEGIN 4 */
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
-    switch  (GPIO_Pin){
-    case SWA_Pin:
-    	Button_IRQ_Handler(&swa);
-    	break;
-
-    case SWB_Pin:
-    	Button_IRQ_Handler(&swb);
-    	break;
-
-    case SWC_Pin:
-    	Button_IRQ_Handler(&swc);
-    	break;
-
 	/*To add more button
-	 * case BUTTTON_NAME:
-	 * Button_IRQ_Handler(&swx);
-	 * break;
+	 * Button_Defer_Attach(&button_defer, &swx); in the setup code
 	 */
-	}
+	Button_Defer_Edge(&button_defer, GPIO_Pin);
 }
 /* USER CODE END 4 */
 
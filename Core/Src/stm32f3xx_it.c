@@ -22,6 +22,9 @@
 #include "stm32f3xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "button_time.h"
+#include "button_defer.h"
+#include "button_callback.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -57,6 +60,7 @@
 /* External variables --------------------------------------------------------*/
 
 /* USER CODE BEGIN EV */
+extern ButtonDefer button_defer;
 
 /* USER CODE END EV */
 
@@ -170,6 +174,8 @@ void DebugMon_Handler(void)
 void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
+  Button_Defer_Process(&button_defer);
+  Button_Callback_Dispatch(BUTTON_CONTEXT_DEFERRED);
 
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
@@ -187,6 +193,8 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  Button_Time_Tick();
+  Button_Timer_Tick();
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -204,6 +212,11 @@ void SysTick_Handler(void)
 void EXTI0_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI0_IRQn 0 */
+#ifdef BUTTON_FAST_ISR
+  // Register-level top half, no HAL_GPIO_EXTI_IRQHandler and callback
+  Button_Defer_IRQHandler(&button_defer, BUTTON_EXTI_LINE(0));
+  return;
+#endif
 
   /* USER CODE END EXTI0_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(SWA_Pin);
@@ -218,6 +231,11 @@ void EXTI0_IRQHandler(void)
 void EXTI1_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI1_IRQn 0 */
+#ifdef BUTTON_FAST_ISR
+  // Register-level top half, no HAL_GPIO_EXTI_IRQHandler and callback
+  Button_Defer_IRQHandler(&button_defer, BUTTON_EXTI_LINE(1));
+  return;
+#endif
 
   /* USER CODE END EXTI1_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(SWB_Pin);
@@ -232,6 +250,12 @@ void EXTI1_IRQHandler(void)
 void EXTI2_TSC_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI2_TSC_IRQn 0 */
+#ifdef BUTTON_FAST_ISR
+  // Register-level top half, no HAL_GPIO_EXTI_IRQHandler and callback.
+  // The vector is shared with the TSC: its handler (Button_Touch_IRQHandler) goes before the return.
+  Button_Defer_IRQHandler(&button_defer, BUTTON_EXTI_LINE(2));
+  return;
+#endif
 
   /* USER CODE END EXTI2_TSC_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(SWC_Pin);
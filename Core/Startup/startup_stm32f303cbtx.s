@@ -44,6 +44,13 @@ defined in linker script */
 .word	_sbss
 /* end address for the .bss section. defined in linker script */
 .word	_ebss
+/* start address for the initialization values of the .ccmram section.
+defined in linker script */
+.word	_siccmram
+/* start address for the .ccmram section. defined in linker script */
+.word	_sccmram
+/* end address for the .ccmram section. defined in linker script */
+.word	_eccmram
 
 .equ  BootRAM,        0xF1E0F85F
 /**
@@ -80,6 +87,23 @@ LoopCopyDataInit:
   adds r4, r0, r3
   cmp r4, r1
   bcc CopyDataInit
+
+/* Copy the ccmram segment (code and data) from flash to CCMRAM */
+  ldr r0, =_sccmram
+  ldr r1, =_eccmram
+  ldr r2, =_siccmram
+  movs r3, #0
+  b LoopCopyCcmramInit
+
+CopyCcmramInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyCcmramInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyCcmramInit
   
 /* Zero fill the bss segment. */
   ldr r2, =_sbss